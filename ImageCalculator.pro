@@ -27,20 +27,13 @@ CONFIG += c++11
 SOURCES += \
         main.cpp \
         mainwindow.cpp\
-        ../../ProjectsLib/LibMarcin/NormalizationLib.cpp \
-        ../../ProjectsLib/LibMarcin/DispLib.cpp \
-        ../../ProjectsLib/LibMarcin/StringFcLib.cpp \
-    ../../ProjectsLib/LibMarcin/histograms.cpp
+        batchrunner.cpp \
+        backgroundprocessor.cpp
 
 HEADERS += \
         mainwindow.h \
-        ../../ProjectsLib/LibMarcin/NormalizationLib.h \
-        ../../ProjectsLib/LibMarcin/DispLib.h \
-        ../../ProjectsLib/LibMarcin/StringFcLib.h \
-        ../../ProjectsLibForein/LibPMS/mazdadummy.h \
-        ../../ProjectsLibForein/LibPMS/mazdaroi.h \
-        ../../ProjectsLibForein/LibPMS/mazdaroiio.h \
-        ../../ProjectsLib/LibMarcin/histograms.h
+        batchrunner.h \
+        backgroundprocessor.h
 
 FORMS += \
         mainwindow.ui
@@ -51,6 +44,8 @@ win32: INCLUDEPATH += ..\..\ProjectsLib\LibMarcin\
 win32: INCLUDEPATH += C:\LibTiff\
 win32: INCLUDEPATH += ../../ProjectsLibForein/LibPMS/
 
+include(ImageCalculatorCore.pri)
+
 # this is for debug
 win32: LIBS += -LC:/opencv/build/x64/vc15/lib/
 win32: LIBS += -lopencv_world341d
@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Builds the processing library, the GUI, the kernel benchmark and the checks
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS = core gui bench jobcheck noisecheck gridcheck
+
+core.file = ImageCalculatorCore.pro
+
+gui.file = ImageCalculator.pro
+gui.depends = core
+
+bench.file = ImageCalculatorBench.pro
+bench.depends = core
+
+jobcheck.file = ImageCalculatorJobCheck.pro
+jobcheck.depends = core
+
+noisecheck.file = ImageCalculatorNoiseCheck.pro
+noisecheck.depends = core
+
+gridcheck.file = ImageCalculatorGridCheck.pro
+gridcheck.depends = core
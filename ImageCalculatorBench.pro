@@ -0,0 +1,37 @@
+#-------------------------------------------------
+#
+# Pixel kernel micro-benchmark, console only, no Qt
+#
+#-------------------------------------------------
+
+QT       -= core gui
+CONFIG   -= qt app_bundle
+CONFIG   += console c++11
+# benchmarks are only meaningful in release
+CONFIG   -= debug
+CONFIG   += release
+
+TARGET = KernelBench
+TEMPLATE = app
+
+SOURCES += \
+        kernelbench.cpp
+
+win32: INCLUDEPATH += C:\opencv\build\include\
+win32: INCLUDEPATH += C:\boost_1_66_0\
+win32: INCLUDEPATH += ..\..\ProjectsLib\LibMarcin\
+win32: INCLUDEPATH += C:\LibTiff\
+win32: INCLUDEPATH += ../../ProjectsLibForein/LibPMS/
+
+include(ImageCalculatorCore.pri)
+
+win32: LIBS += -LC:/opencv/build/x64/vc15/lib/
+win32: LIBS += -lopencv_world341
+
+win32: LIBS += -LC:/boost_1_66_0/stage/x64/lib/
+win32:  LIBS += -lboost_filesystem-vc141-mt-x64-1_66
+win32:  LIBS += -lboost_regex-vc141-mt-x64-1_66
+win32:  LIBS += -lboost_random-vc141-mt-x64-1_66
+
+win32: LIBS += -LC:/LibTiff/
+win32: LIBS += -llibtiff_i
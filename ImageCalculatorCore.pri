@@ -0,0 +1,13 @@
+# Links ImageCalculatorCore. The library has to be built first, ImageCalculatorAll.pro does that.
+# Include before the OpenCV / Boost / LibTiff LIBS, the static library depends on them.
+
+INCLUDEPATH += $$PWD
+
+win32:CONFIG(release, debug|release): CORE_LIB_DIR = $$OUT_PWD/release
+else:win32:CONFIG(debug, debug|release): CORE_LIB_DIR = $$OUT_PWD/debug
+else: CORE_LIB_DIR = $$OUT_PWD
+
+LIBS += -L$$CORE_LIB_DIR -lImageCalculatorCore
+
+win32-msvc*: PRE_TARGETDEPS += $$CORE_LIB_DIR/ImageCalculatorCore.lib
+else: PRE_TARGETDEPS += $$CORE_LIB_DIR/libImageCalculatorCore.a
@@ -0,0 +1,60 @@
+#-------------------------------------------------
+#
+# Qt-free processing library: parameters, modes, batch pipeline.
+# Linked by the GUI and the benchmark through ImageCalculatorCore.pri
+#
+#-------------------------------------------------
+
+QT       -= core gui
+CONFIG   -= qt
+CONFIG   += staticlib c++11
+
+TARGET = ImageCalculatorCore
+TEMPLATE = lib
+
+SOURCES += \
+        ImageCalculatorLib.cpp \
+        imagecache.cpp \
+        filecatalog.cpp \
+        normalisationlut.cpp \
+        displaylut.cpp \
+        displaystats.cpp \
+        labelstats.cpp \
+        roiindex.cpp \
+        roigrid.cpp \
+        firstorder.cpp \
+        commandjobs.cpp \
+        ../../ProjectsLib/LibMarcin/NormalizationLib.cpp \
+        ../../ProjectsLib/LibMarcin/DispLib.cpp \
+        ../../ProjectsLib/LibMarcin/StringFcLib.cpp \
+    ../../ProjectsLib/LibMarcin/histograms.cpp
+
+HEADERS += \
+        ImageCalculatorLib.h \
+        boundedqueue.h \
+        imagecache.h \
+        stagememo.h \
+        filecatalog.h \
+        stagetimer.h \
+        normalisationlut.h \
+        philoxrng.h \
+        displaylut.h \
+        displaystats.h \
+        labelstats.h \
+        roiindex.h \
+        roigrid.h \
+        firstorder.h \
+        commandjobs.h \
+        ../../ProjectsLib/LibMarcin/NormalizationLib.h \
+        ../../ProjectsLib/LibMarcin/DispLib.h \
+        ../../ProjectsLib/LibMarcin/StringFcLib.h \
+        ../../ProjectsLibForein/LibPMS/mazdadummy.h \
+        ../../ProjectsLibForein/LibPMS/mazdaroi.h \
+        ../../ProjectsLibForein/LibPMS/mazdaroiio.h \
+        ../../ProjectsLib/LibMarcin/histograms.h
+
+win32: INCLUDEPATH += C:\opencv\build\include\
+win32: INCLUDEPATH += C:\boost_1_66_0\
+win32: INCLUDEPATH += ..\..\ProjectsLib\LibMarcin\
+win32: INCLUDEPATH += C:\LibTiff\
+win32: INCLUDEPATH += ../../ProjectsLibForein/LibPMS/
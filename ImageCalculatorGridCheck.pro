@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Check of the ROI grid against the painted mask and of its tile statistics, console only, no Qt
+#
+#-------------------------------------------------
+
+QT       -= core gui
+CONFIG   -= qt app_bundle
+CONFIG   += console c++11
+
+TARGET = GridCheck
+TEMPLATE = app
+
+SOURCES += \
+        gridcheck.cpp
+
+win32: INCLUDEPATH += C:\opencv\build\include\
+
+include(ImageCalculatorCore.pri)
+
+win32: LIBS += -LC:/opencv/build/x64/vc15/lib/
+win32: LIBS += -lopencv_world341
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Check of the local job runner against itself as a stub command, console only, no Qt
+#
+#-------------------------------------------------
+
+QT       -= core gui
+CONFIG   -= qt app_bundle
+CONFIG   += console c++11
+
+TARGET = JobCheck
+TEMPLATE = app
+
+SOURCES += \
+        jobcheck.cpp
+
+win32: INCLUDEPATH += C:\boost_1_66_0\
+
+include(ImageCalculatorCore.pri)
+
+win32: LIBS += -LC:/boost_1_66_0/stage/x64/lib/
+win32:  LIBS += -lboost_filesystem-vc141-mt-x64-1_66
@@ -0,0 +1,2888 @@
+#include "ImageCalculatorLib.h"
+#include "boundedqueue.h"
+#include "imagecache.h"
+#include "stagememo.h"
+#include "filecatalog.h"
+#include "normalisationlut.h"
+#include "philoxrng.h"
+#include "displaylut.h"
+#include "displaystats.h"
+#include "labelstats.h"
+#include "roiindex.h"
+#include "firstorder.h"
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <ctime>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include <boost/filesystem.hpp>
+#include <boost/regex.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <boost/random/linear_congruential.hpp>
+
+#include <math.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "NormalizationLib.h"
+#include "DispLib.h"
+#include "StringFcLib.h"
+#include "histograms.h"
+
+#include "mazdaroi.h"
+#include "mazdaroiio.h"
+
+#include <tiffio.h>
+
+typedef MazdaRoi<unsigned int, 2> MR2DType;
+
+using namespace boost;
+using namespace std;
+using namespace boost::filesystem;
+using namespace cv;
+
+//------------------------------------------------------------------------------------------------------------------------------
+//          Parameters and results
+//------------------------------------------------------------------------------------------------------------------------------
+ImageCalculatorParams::ImageCalculatorParams()
+{
+    operationMode = 3;
+
+    RegexImageFile = ".+.tiff";
+    minImageWidth = 0;
+    minImageHeight = 0;
+    imageBitsPerSample = 0;
+
+    randomSeed = (unsigned int)time(0);
+    threadCount = 0;
+    readThreadCount = 2;
+    queueSize = 0;
+    imageCacheMB = 512;
+
+    loadAnydepth = 1;
+    showTiffInfo = 1;
+    showMatInfo = 0;
+    showInput = 1;
+    showInputModyfied = 1;
+
+    showOutput = 1;
+    displayScale = 2.0;
+    displayRange = 2;
+    fixMinDisp = 0.0;
+    fixMaxDisp = 1024.0;
+
+    showHist = 1;
+    histScaleHeight = 5;
+    histScaleCoef = 2;
+    histBarWidth = 4;
+    fixRangeHistogram = 0;
+    minHist = 0;
+    maxHist = 350;
+
+    saveOutput = 0;
+
+    annotationRule = 0;
+    annotationKeyR = 255;
+    annotationKeyG = 0;
+    annotationKeyB = 0;
+    annotationTolerance = 16;
+    annotationMaskBits = 16;
+
+    resizeScale = 0.5;
+    resizeInterpolation = CV_INTER_AREA;
+    keepRequestedPixelSize = 0;
+    xPixSizeOut = 0.633;
+    showOutMatInfo = 0;
+
+    plainImage = 0;
+    intensityScale = 1.0;
+    intOffset = 1000.0;
+    addNoise = 0;
+    gaussNoiseSigma = 25.6;
+    addUniformNoise = 0;
+    uniformNoiseStart = -25;
+    uniformNoiseStop = 25;
+    addRician = 0;
+    ricianS = 25.6;
+    addGradient = 0;
+    gradientDirection = 0;
+    gradNominator = 0.5;
+    gradDenominator = 1.0;
+
+    roiShape = 0;
+    roiSize = 61;
+    roiOffset = 38;
+    roiShift = 62;
+    reducedRoi = 0;
+    reducedRoiComplement = 0;
+    skipCount = 3;
+    roiTileSize = 1024;
+    roiNr = 0;
+    roiScale = 1.0;
+    roiNorm = 0;
+    roiBitPerPix = 3;
+    saveRoi = 0;
+    saveRoiBmp = 0;
+    saveRoiHistogram = 0;
+    saveStatistics = 0;
+    showNormalisedRoi = 0;
+    saveNormalisedRoiImage = 0;
+    showBinnedRoi = 0;
+    saveBinnedRoiImage = 0;
+    saveBinnedRoiHist = 0;
+
+    MaZdaFileLocation = "E:\\PortableSoft\\qmazda1902_win64\\MzGenerator.exe";
+    MaZdaInFilesFolder = "Figs\\";
+    MaZdaROIFolder = "Figs\\";
+    MaZdaOutFileName = "Out\\Kidneys";
+    MaZdaOptionsFile = "GLCM_M3";
+    MaZdaOptionsDir = "Opt\\";
+    MaZdaOptionsExtension = "txt";
+    MaZdaScriptFileName = "Analysis";
+    MaZdaInProcess = 0;
+    MaZdaRunJobs = 0;
+    jobCount = 0;
+    jobTimeout = 0.0;
+    jobRetries = 1;
+
+    ViewROIFolder = "ROI/";
+    viewRoiNr = 1;
+    viewRoiNorm = 0;
+    viewRoiBitPerPixel = 3;
+    viewRoiShowBinned = 1;
+    showRoiOnImage = 1;
+    viewSaveBinnedRoiImage = 0;
+    viewSaveRoiBinnedHistogram = 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+BatchReport::BatchReport()
+{
+    filesCount = 0;
+    threadCount = 0;
+    readThreadCount = 0;
+    seconds = 0.0;
+    inputFileBytes = 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+ImageCalculatorResult::ImageCalculatorResult()
+{
+    fileNr = 0;
+    inputFileBytes = 0;
+    xPixelSize = 1.0;
+    resizeScale = 1.0;
+    xPixSizeOut = 1.0;
+    maxRoiNr = 0;
+    cancelRequested = 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool Cancelled(const ImageCalculatorResult &Result)
+{
+    return Result.cancelRequested && Result.cancelRequested->load();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string NumberToString(double value)
+{
+    ostringstream Out;
+    Out << value;
+    return Out.str();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string StageTimesAsText(const StageTimes &Times)
+{
+    ostringstream Out;
+    Out << fixed << setprecision(3);
+    for(auto &Item : Times)
+        Out << setw(16) << left << Item.first << right << setw(10) << Item.second.seconds * 1000.0 << " ms  " << Item.second.calls << "x\n";
+    return Out.str();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string NumberToString(double value, int decimals)
+{
+    ostringstream Out;
+    Out << fixed << setprecision(decimals) << value;
+    return Out.str();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void AddInfo(ImageCalculatorResult &Result, string Text)
+{
+    Result.Info += Text;
+    Result.Info += "\n";
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void AddImageToShow(ImageCalculatorResult &Result, string WindowName, Mat Im)
+{
+    ImageToShow ToShow;
+    ToShow.WindowName = WindowName;
+    ToShow.Im = Im;
+    Result.ImagesToShow.push_back(ToShow);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void AddHistogramToShow(HistogramInteger &Hist, string WindowName, const ImageCalculatorParams &Params, ImageCalculatorResult &Result)
+{
+    Mat HistPlot = Hist.Plot(Params.histScaleHeight,
+                             Params.histScaleCoef,
+                             Params.histBarWidth);
+    AddImageToShow(Result, WindowName, HistPlot);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// files are written by SaveResultFiles, in batch mode on the writer thread
+void AddFileToSave(ImageCalculatorResult &Result, string FileName, Mat Im, int bitsPerPixel = 0)
+{
+    FileToSave ToSave;
+    ToSave.FileName = FileName;
+    ToSave.Im = Im;
+    ToSave.bitsPerPixel = bitsPerPixel;
+    Result.FilesToSave.push_back(ToSave);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void AddTextToSave(ImageCalculatorResult &Result, string FileName, string Text)
+{
+    FileToSave ToSave;
+    ToSave.FileName = FileName;
+    ToSave.Text = Text;
+    Result.FilesToSave.push_back(ToSave);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void SaveResultFiles(ImageCalculatorResult &Result)
+{
+    ScopedTimer Timer(Result.Timings, "encode");
+    for(FileToSave &ToSave : Result.FilesToSave)
+    {
+        if(!ToSave.Im.empty() && ToSave.bitsPerPixel == 1)
+        {
+            if(!SaveBilevelTiff(ToSave.FileName, ToSave.Im))
+                AddInfo(Result, "cannot save " + ToSave.FileName);
+        }
+        else if(!ToSave.Im.empty())
+        {
+            if(!imwrite(ToSave.FileName, ToSave.Im))
+                AddInfo(Result, "cannot save " + ToSave.FileName);
+        }
+        else
+        {
+            std::ofstream out (ToSave.FileName);
+            out << ToSave.Text;
+            out.close();
+        }
+    }
+    Result.FilesToSave.clear();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+//          Helpers
+//------------------------------------------------------------------------------------------------------------------------------
+// Every ROI is decoded into row spans over its own begin - end extent, ROIs in parallel. ROI i gets
+// label i + 1 and where ROIs overlap the later one wins, as when painted in file order.
+// RoiNames, when given, gets the name of every ROI of the file.
+RoiIndex LoadRoiIndex(boost::filesystem::path InputFile, Size ImSize, vector<string> *RoiNames)
+{
+    if(RoiNames)
+        RoiNames->clear();
+    RoiIndex Index;
+    Index.Reset(ImSize);
+    if(!exists(InputFile))
+    {
+        Index.Finish();
+        return Index;
+    }
+
+    vector <MR2DType*> ROIVect = MazdaRoiIO<MR2DType>::Read(InputFile.string());
+    int numRois = (int)ROIVect.size();
+    if(RoiNames)
+    {
+        for(MR2DType *ROI : ROIVect)
+            RoiNames->push_back(ROI->GetName());
+    }
+
+    vector<vector<RoiSpan>> RoiSpans(numRois);
+    parallel_for_(Range(0, numRois), [&](const Range &Rois)
+    {
+        for(int i = Rois.start; i < Rois.end; i++)
+        {
+            MR2DType *ROI = ROIVect[i];
+            if(ROI->IsEmpty())
+                continue;
+            int begin[MR2DType::Dimensions];
+            int end[MR2DType::Dimensions];
+            ROI->GetBegin(begin);
+            ROI->GetEnd(end);
+            int width = end[0] - begin[0] + 1;
+            int height = end[1] - begin[1] + 1;
+            if(width <= 0 || height <= 0)
+                continue;
+
+            MazdaRoiIterator<MR2DType> iterator(ROI);
+            for(int y = begin[1]; y <= end[1] && !iterator.IsBehind(); y++)
+            {
+                RoiSpan Span;
+                Span.y = y;
+                Span.xStart = -1;
+                int x = begin[0];
+                for(; x <= end[0] && !iterator.IsBehind(); x++, ++iterator)
+                {
+                    if(iterator.GetPixel())
+                    {
+                        if(Span.xStart < 0)
+                            Span.xStart = x;
+                    }
+                    else if(Span.xStart >= 0)
+                    {
+                        Span.xEnd = x;
+                        RoiSpans[i].push_back(Span);
+                        Span.xStart = -1;
+                    }
+                }
+                if(Span.xStart >= 0)
+                {
+                    Span.xEnd = x;
+                    RoiSpans[i].push_back(Span);
+                }
+            }
+        }
+    });
+
+    for(int i = 0; i < numRois; i++)
+        for(const RoiSpan &Span : RoiSpans[i])
+            Index.AddSpan(i + 1, Span.y, Span.xStart, Span.xEnd);
+    Index.Finish();
+
+    while(ROIVect.size() > 0)
+    {
+         delete ROIVect.back();
+         ROIVect.pop_back();
+    }
+    return Index;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// 16U mask, 32S when the file has more than 65535 ROIs
+Mat LoadROI(boost::filesystem::path InputFile,int maxX, int maxY)
+{
+    return LoadRoiIndex(InputFile, Size(maxX, maxY)).ToMat();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string InterpolationToString(int interpolationNr)
+{
+    switch(interpolationNr)
+    {
+    case CV_INTER_NN:
+        return "interpolation nearest neighbour";
+        break;
+    case CV_INTER_LINEAR:
+        return "interpolation bilinear";
+        break;
+    case CV_INTER_CUBIC:
+        return "interpolation bicubic";
+        break;
+    case CV_INTER_AREA:
+        return "interpolation area";
+        break;
+    case CV_INTER_LANCZOS4:
+        return "interpolation Lanczos";
+        break;
+    default:
+        return "unrecognized interpolation";
+        break;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool GetTiffProperties(string FileName, float &xRes, float &yRes)
+{
+    TIFF *tifIm = TIFFOpen(FileName.c_str(),"r");
+    if(tifIm)
+    {
+        TIFFGetField(tifIm, TIFFTAG_XRESOLUTION , &xRes);
+        TIFFGetField(tifIm, TIFFTAG_YRESOLUTION , &yRes);
+
+        TIFFClose(tifIm);
+        return 1;
+    }
+    else
+    {
+        xRes = 1.0;
+        yRes = 1.0;
+        return 0;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// 8U mask, any non zero pixel is written as 1, rows packed 8 pixels per byte
+bool SaveBilevelTiff(string FileName, Mat Mask)
+{
+    if(Mask.empty() || Mask.type() != CV_8U)
+        return 0;
+    TIFF *tifIm = TIFFOpen(FileName.c_str(),"w");
+    if(!tifIm)
+        return 0;
+
+    int maxX = Mask.cols;
+    int maxY = Mask.rows;
+    TIFFSetField(tifIm, TIFFTAG_IMAGEWIDTH, (uint32_t)maxX);
+    TIFFSetField(tifIm, TIFFTAG_IMAGELENGTH, (uint32_t)maxY);
+    TIFFSetField(tifIm, TIFFTAG_BITSPERSAMPLE, 1);
+    TIFFSetField(tifIm, TIFFTAG_SAMPLESPERPIXEL, 1);
+    TIFFSetField(tifIm, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+    TIFFSetField(tifIm, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+    TIFFSetField(tifIm, TIFFTAG_COMPRESSION, COMPRESSION_PACKBITS);
+    TIFFSetField(tifIm, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(tifIm, 0));
+
+    vector<uint8_t> Row((maxX + 7) / 8);
+    bool success = 1;
+    for(int y = 0; y < maxY && success; y++)
+    {
+        const uint8_t *wMask = Mask.ptr<uint8_t>(y);
+        std::fill(Row.begin(), Row.end(), 0);
+        for(int x = 0; x < maxX; x++)
+        {
+            if(wMask[x])
+                Row[x >> 3] |= (uint8_t)(0x80 >> (x & 7));
+        }
+        success = TIFFWriteScanline(tifIm, Row.data(), y, 0) >= 0;
+    }
+    TIFFClose(tifIm);
+    return success;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// 8U and 16U inputs go through a cached lookup table, 32F is computed per pixel; rows run in parallel
+Mat CreateNormalisedImage16U(Mat ImIn, double minNorm, double maxNorm, int nrOfBins)
+{
+    Mat ImOut;
+    ImOut.release();
+    if(ImIn.empty())
+        return ImOut;
+    if(ImIn.channels() != 1)
+        return ImOut;
+    int depth = ImIn.depth();
+    if(depth != CV_8U && depth != CV_16U && depth != CV_32F)
+        return ImOut;
+
+    int maxX = ImIn.cols;
+    int maxY = ImIn.rows;
+    ImOut = Mat(maxY,maxX,CV_16U);
+
+    // small ROI crops are not worth the thread hand off
+    double stripesCount = (maxX * maxY < 65536) ? 1.0 : -1.0;
+
+    if(depth == CV_32F)
+    {
+        double maxVal = (double)(nrOfBins-1);
+        double offset = minNorm;
+        double normRange = maxNorm - minNorm;
+        if(normRange == 0.0)
+            normRange = 1.0;
+        double coeff = maxVal/normRange;
+
+        parallel_for_(Range(0, maxY), [&](const Range &Rows)
+        {
+            for(int y = Rows.start; y < Rows.end; y++)
+            {
+                const float *wImIn = ImIn.ptr<float>(y);
+                uint16_t *wImOut = ImOut.ptr<uint16_t>(y);
+                for(int x = 0; x < maxX; x++)
+                {
+                    double val = ((double)wImIn[x] - offset) * coeff;
+                    if(val > maxVal)
+                        val = maxVal;
+                    // also catches NaN, which would make the cast undefined
+                    if(!(val > 0))
+                        val = 0;
+                    wImOut[x] = (uint16_t)round(val);
+                }
+            }
+        }, stripesCount);
+        return ImOut;
+    }
+
+    std::shared_ptr<const NormalisationTable> Table = GetNormalisationTable(minNorm, maxNorm, nrOfBins, depth == CV_8U ? 256 : 65536);
+    const uint16_t *LUT = Table->data();
+    parallel_for_(Range(0, maxY), [&](const Range &Rows)
+    {
+        for(int y = Rows.start; y < Rows.end; y++)
+        {
+            uint16_t *wImOut = ImOut.ptr<uint16_t>(y);
+            if(depth == CV_8U)
+            {
+                const uint8_t *wImIn = ImIn.ptr<uint8_t>(y);
+                for(int x = 0; x < maxX; x++)
+                    wImOut[x] = LUT[wImIn[x]];
+            }
+            else
+            {
+                const uint16_t *wImIn = ImIn.ptr<uint16_t>(y);
+                for(int x = 0; x < maxX; x++)
+                    wImOut[x] = LUT[wImIn[x]];
+            }
+        }
+    }, stripesCount);
+    return ImOut;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// goes through the folder catalog, a repeated run only reads headers of new or changed files
+vector<string> GetImageFileList(const ImageCalculatorParams &Params)
+{
+    FileCatalog ImageCatalog;
+    if(!ImageCatalog.Open(Params.ImageFolder))
+        return vector<string>();
+
+    CatalogFilter Filter;
+    Filter.RegexImageFile = Params.RegexImageFile;
+    Filter.minWidth = Params.minImageWidth;
+    Filter.minHeight = Params.minImageHeight;
+    Filter.bitsPerSample = Params.imageBitsPerSample;
+    // sorted by file name, batch output stays reproducible
+    return ImageCatalog.Filter(Filter);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+//          Parameter file
+//------------------------------------------------------------------------------------------------------------------------------
+bool ParamToInt(string Value, int &Out)
+{
+    try
+    {
+        Out = lexical_cast<int>(Value);
+    }
+    catch(bad_lexical_cast &)
+    {
+        return 0;
+    }
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool ParamToDouble(string Value, double &Out)
+{
+    try
+    {
+        Out = lexical_cast<double>(Value);
+    }
+    catch(bad_lexical_cast &)
+    {
+        return 0;
+    }
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool ParamToBool(string Value, bool &Out)
+{
+    if(Value == "1" || Value == "true" || Value == "yes" || Value == "on")
+        Out = 1;
+    else if(Value == "0" || Value == "false" || Value == "no" || Value == "off")
+        Out = 0;
+    else
+        return 0;
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool SetParam(ImageCalculatorParams &Params, string Key, string Value)
+{
+    if(Key == "operationMode")          return ParamToInt(Value, Params.operationMode);
+    if(Key == "ImageFolder")            { Params.ImageFolder = Value; return 1; }
+    if(Key == "OutFolder")              { Params.OutFolder = Value; return 1; }
+    if(Key == "RegexImageFile")         { Params.RegexImageFile = Value; return 1; }
+    if(Key == "minImageWidth")          return ParamToInt(Value, Params.minImageWidth);
+    if(Key == "minImageHeight")         return ParamToInt(Value, Params.minImageHeight);
+    if(Key == "imageBitsPerSample")     return ParamToInt(Value, Params.imageBitsPerSample);
+    if(Key == "threadCount")            return ParamToInt(Value, Params.threadCount);
+    if(Key == "readThreadCount")        return ParamToInt(Value, Params.readThreadCount);
+    if(Key == "queueSize")              return ParamToInt(Value, Params.queueSize);
+    if(Key == "imageCacheMB")           return ParamToInt(Value, Params.imageCacheMB);
+    if(Key == "randomSeed")
+    {
+        int seed;
+        if(!ParamToInt(Value, seed))
+            return 0;
+        Params.randomSeed = (unsigned int)seed;
+        return 1;
+    }
+
+    if(Key == "loadAnydepth")           return ParamToBool(Value, Params.loadAnydepth);
+    if(Key == "showTiffInfo")           return ParamToBool(Value, Params.showTiffInfo);
+    if(Key == "showMatInfo")            return ParamToBool(Value, Params.showMatInfo);
+    if(Key == "showInput")              return ParamToBool(Value, Params.showInput);
+    if(Key == "showInputModyfied")      return ParamToBool(Value, Params.showInputModyfied);
+
+    if(Key == "showOutput")             return ParamToBool(Value, Params.showOutput);
+    if(Key == "displayScale")           return ParamToDouble(Value, Params.displayScale);
+    if(Key == "displayRange")           return ParamToInt(Value, Params.displayRange);
+    if(Key == "fixMinDisp")             return ParamToDouble(Value, Params.fixMinDisp);
+    if(Key == "fixMaxDisp")             return ParamToDouble(Value, Params.fixMaxDisp);
+
+    if(Key == "showHist")               return ParamToBool(Value, Params.showHist);
+    if(Key == "histScaleHeight")        return ParamToInt(Value, Params.histScaleHeight);
+    if(Key == "histScaleCoef")          return ParamToInt(Value, Params.histScaleCoef);
+    if(Key == "histBarWidth")           return ParamToInt(Value, Params.histBarWidth);
+    if(Key == "fixRangeHistogram")      return ParamToBool(Value, Params.fixRangeHistogram);
+    if(Key == "minHist")                return ParamToInt(Value, Params.minHist);
+    if(Key == "maxHist")                return ParamToInt(Value, Params.maxHist);
+
+    if(Key == "saveOutput")             return ParamToBool(Value, Params.saveOutput);
+
+    if(Key == "annotationRule")         return ParamToInt(Value, Params.annotationRule);
+    if(Key == "annotationKeyR")         return ParamToInt(Value, Params.annotationKeyR);
+    if(Key == "annotationKeyG")         return ParamToInt(Value, Params.annotationKeyG);
+    if(Key == "annotationKeyB")         return ParamToInt(Value, Params.annotationKeyB);
+    if(Key == "annotationTolerance")    return ParamToInt(Value, Params.annotationTolerance);
+    if(Key == "annotationMaskBits")
+    {
+        // the mask is saved with 16, 8 or 1 bit per pixel only
+        int bits;
+        if(!ParamToInt(Value, bits) || (bits != 16 && bits != 8 && bits != 1))
+            return 0;
+        Params.annotationMaskBits = bits;
+        return 1;
+    }
+
+    if(Key == "resizeScale")            return ParamToDouble(Value, Params.resizeScale);
+    if(Key == "resizeInterpolation")    return ParamToInt(Value, Params.resizeInterpolation);
+    if(Key == "keepRequestedPixelSize") return ParamToBool(Value, Params.keepRequestedPixelSize);
+    if(Key == "xPixSizeOut")            return ParamToDouble(Value, Params.xPixSizeOut);
+    if(Key == "showOutMatInfo")         return ParamToBool(Value, Params.showOutMatInfo);
+
+    if(Key == "plainImage")             return ParamToBool(Value, Params.plainImage);
+    if(Key == "intensityScale")         return ParamToDouble(Value, Params.intensityScale);
+    if(Key == "intOffset")              return ParamToDouble(Value, Params.intOffset);
+    if(Key == "addNoise")               return ParamToBool(Value, Params.addNoise);
+    if(Key == "gaussNoiseSigma")        return ParamToDouble(Value, Params.gaussNoiseSigma);
+    if(Key == "addUniformNoise")        return ParamToBool(Value, Params.addUniformNoise);
+    if(Key == "uniformNoiseStart")      return ParamToInt(Value, Params.uniformNoiseStart);
+    if(Key == "uniformNoiseStop")       return ParamToInt(Value, Params.uniformNoiseStop);
+    if(Key == "addRician")              return ParamToBool(Value, Params.addRician);
+    if(Key == "ricianS")                return ParamToDouble(Value, Params.ricianS);
+    if(Key == "addGradient")            return ParamToBool(Value, Params.addGradient);
+    if(Key == "gradientDirection")      return ParamToInt(Value, Params.gradientDirection);
+    if(Key == "gradNominator")          return ParamToDouble(Value, Params.gradNominator);
+    if(Key == "gradDenominator")        return ParamToDouble(Value, Params.gradDenominator);
+
+    if(Key == "roiShape")               return ParamToInt(Value, Params.roiShape);
+    if(Key == "roiSize")                return ParamToInt(Value, Params.roiSize);
+    if(Key == "roiOffset")              return ParamToInt(Value, Params.roiOffset);
+    if(Key == "roiShift")               return ParamToInt(Value, Params.roiShift);
+    if(Key == "reducedRoi")             return ParamToBool(Value, Params.reducedRoi);
+    if(Key == "reducedRoiComplement")   return ParamToBool(Value, Params.reducedRoiComplement);
+    if(Key == "skipCount")              return ParamToInt(Value, Params.skipCount);
+    if(Key == "roiTileSize")            return ParamToInt(Value, Params.roiTileSize);
+    if(Key == "roiNr")                  return ParamToInt(Value, Params.roiNr);
+    if(Key == "roiScale")               return ParamToDouble(Value, Params.roiScale);
+    if(Key == "roiNorm")                return ParamToInt(Value, Params.roiNorm);
+    if(Key == "roiBitPerPix")           return ParamToInt(Value, Params.roiBitPerPix);
+    if(Key == "saveRoi")                return ParamToBool(Value, Params.saveRoi);
+    if(Key == "saveRoiBmp")             return ParamToBool(Value, Params.saveRoiBmp);
+    if(Key == "saveRoiHistogram")       return ParamToBool(Value, Params.saveRoiHistogram);
+    if(Key == "saveStatistics")         return ParamToBool(Value, Params.saveStatistics);
+    if(Key == "showNormalisedRoi")      return ParamToBool(Value, Params.showNormalisedRoi);
+    if(Key == "saveNormalisedRoiImage") return ParamToBool(Value, Params.saveNormalisedRoiImage);
+    if(Key == "showBinnedRoi")          return ParamToBool(Value, Params.showBinnedRoi);
+    if(Key == "saveBinnedRoiImage")     return ParamToBool(Value, Params.saveBinnedRoiImage);
+    if(Key == "saveBinnedRoiHist")      return ParamToBool(Value, Params.saveBinnedRoiHist);
+
+    if(Key == "MaZdaFileLocation")      { Params.MaZdaFileLocation = Value; return 1; }
+    if(Key == "MaZdaInFilesFolder")     { Params.MaZdaInFilesFolder = Value; return 1; }
+    if(Key == "MaZdaROIFolder")         { Params.MaZdaROIFolder = Value; return 1; }
+    if(Key == "MaZdaOutFileName")       { Params.MaZdaOutFileName = Value; return 1; }
+    if(Key == "MaZdaOptionsFile")       { Params.MaZdaOptionsFile = Value; return 1; }
+    if(Key == "MaZdaOptionsDir")        { Params.MaZdaOptionsDir = Value; return 1; }
+    if(Key == "MaZdaOptionsExtension")  { Params.MaZdaOptionsExtension = Value; return 1; }
+    if(Key == "MaZdaScriptFileName")    { Params.MaZdaScriptFileName = Value; return 1; }
+    if(Key == "MaZdaInProcess")         return ParamToBool(Value, Params.MaZdaInProcess);
+    if(Key == "MaZdaRunJobs")           return ParamToBool(Value, Params.MaZdaRunJobs);
+    if(Key == "jobCount")               return ParamToInt(Value, Params.jobCount);
+    if(Key == "jobTimeout")             return ParamToDouble(Value, Params.jobTimeout);
+    if(Key == "jobRetries")             return ParamToInt(Value, Params.jobRetries);
+
+    if(Key == "ViewROIFolder")          { Params.ViewROIFolder = Value; return 1; }
+    if(Key == "viewRoiNr")              return ParamToInt(Value, Params.viewRoiNr);
+    if(Key == "viewRoiNorm")            return ParamToInt(Value, Params.viewRoiNorm);
+    if(Key == "viewRoiBitPerPixel")     return ParamToInt(Value, Params.viewRoiBitPerPixel);
+    if(Key == "viewRoiShowBinned")      return ParamToBool(Value, Params.viewRoiShowBinned);
+    if(Key == "showRoiOnImage")         return ParamToBool(Value, Params.showRoiOnImage);
+    if(Key == "viewSaveBinnedRoiImage") return ParamToBool(Value, Params.viewSaveBinnedRoiImage);
+    if(Key == "viewSaveRoiBinnedHistogram") return ParamToBool(Value, Params.viewSaveRoiBinnedHistogram);
+
+    return 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// one "key = value" pair per line, '#' starts a comment
+bool LoadParamsFile(ImageCalculatorParams &Params, boost::filesystem::path ParamsFile, string *Error)
+{
+    std::ifstream in(ParamsFile.string());
+    if(!in.is_open())
+    {
+        *Error = "cannot open parameter file " + ParamsFile.string();
+        return 0;
+    }
+    string Line;
+    int lineNr = 0;
+    while(getline(in, Line))
+    {
+        lineNr++;
+        size_t commentPos = Line.find('#');
+        if(commentPos != string::npos)
+            Line.erase(commentPos);
+        trim(Line);
+        if(Line.empty())
+            continue;
+
+        size_t separatorPos = Line.find('=');
+        if(separatorPos == string::npos)
+        {
+            *Error = ParamsFile.string() + " line " + to_string(lineNr) + ": missing '='";
+            return 0;
+        }
+        string Key = trim_copy(Line.substr(0, separatorPos));
+        string Value = trim_copy(Line.substr(separatorPos + 1));
+        if(!SetParam(Params, Key, Value))
+        {
+            *Error = ParamsFile.string() + " line " + to_string(lineNr) + ": improper parameter " + Key + " = " + Value;
+            return 0;
+        }
+    }
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+//          Display
+//------------------------------------------------------------------------------------------------------------------------------
+// modes 2 - 4 from the cached histogram and moments of the image, the LibMarcin functions for images it does not cover
+bool DisplayRangeFromStatistics(std::shared_ptr<const DisplayStatistics> Stats, int dispMode, double *minDisp, double *maxDisp)
+{
+    if(!Stats)
+        return 0;
+    switch(dispMode)
+    {
+    case 2:
+        *minDisp = Stats->minValue;
+        *maxDisp = Stats->maxValue;
+        break;
+    case 3:
+        *minDisp = Stats->Mean() - 3.0 * Stats->Std();
+        *maxDisp = Stats->Mean() + 3.0 * Stats->Std();
+        break;
+    case 4:
+        *minDisp = Stats->Percentile(0.01);
+        *maxDisp = Stats->Percentile(0.99);
+        break;
+    default:
+        break;
+    }
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void GetDisplayRange(Mat Im, int dispMode, const ImageCalculatorParams &Params, double *minDisp, double *maxDisp, const string &ImageKey)
+{
+    if(dispMode == 1)
+    {
+        *minDisp = Params.fixMinDisp;
+        *maxDisp = Params.fixMaxDisp;
+        return;
+    }
+    if(dispMode < 2 || dispMode > 4 || DisplayRangeFromStatistics(GetDisplayStatistics(ImageKey, Im), dispMode, minDisp, maxDisp))
+        return;
+    switch(dispMode)
+    {
+    case 2:
+        NormParamsMinMax(Im, maxDisp, minDisp);
+        break;
+    case 3:
+        NormParamsMeanP3Std(Im, maxDisp, minDisp);
+        break;
+    case 4:
+        NormParams1to99perc(Im, maxDisp, minDisp);
+        break;
+    default:
+        break;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void GetDisplayRange(Mat Im, Mat Mask, int dispMode, const ImageCalculatorParams &Params, double *minDisp, double *maxDisp)
+{
+    if(dispMode == 1)
+    {
+        *minDisp = Params.fixMinDisp;
+        *maxDisp = Params.fixMaxDisp;
+        return;
+    }
+    if(dispMode < 2 || dispMode > 4 || DisplayRangeFromStatistics(GetDisplayStatistics(Im, Mask, RoiIndex::CropLabel), dispMode, minDisp, maxDisp))
+        return;
+    switch(dispMode)
+    {
+    case 2:
+        NormParamsMinMax(Im, Mask, RoiIndex::CropLabel, maxDisp, minDisp);
+        break;
+    case 3:
+        NormParamsMeanP3Std(Im, Mask, RoiIndex::CropLabel, maxDisp, minDisp);
+        break;
+    case 4:
+        NormParams1to99perc(Im, Mask, RoiIndex::CropLabel, maxDisp, minDisp);
+        break;
+    default:
+        break;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// Downscales first and colours only the reduced image. 8U and 16U go through a cached pseudo colour
+// table, other types are coloured per pixel by ShowImageF64PseudoColor. dispMode 0 shows the values.
+Mat RenderForDisplay(Mat Im, double dispScale, int dispMode, double minDisp, double maxDisp)
+{
+    bool tableInput = Im.channels() == 1 && (Im.depth() == CV_8U || Im.depth() == CV_16U);
+    Mat ImSmall = Im;
+    if(dispMode > 0 && !tableInput)
+        Im.convertTo(ImSmall, CV_64F);
+    if(dispScale != 1.0)
+        cv::resize(ImSmall, ImSmall, Size(), dispScale, dispScale, INTER_AREA);
+
+    if(dispMode <= 0)
+        return ImSmall.data == Im.data ? Im.clone() : ImSmall;
+    if(!tableInput)
+        return ShowImageF64PseudoColor(ImSmall, minDisp, maxDisp);
+
+    std::shared_ptr<const Mat> Table = GetPseudoColorTable(minDisp, maxDisp, Im.depth() == CV_8U ? 256 : 65536);
+    return ApplyDisplayTable(ImSmall, *Table);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// the input image is named by Result.ImInKey; Result holds it, so its buffer cannot belong to another image
+string DisplayKey(const Mat &Im, const ImageCalculatorResult &Result)
+{
+    if(Im.data == Result.ImIn.data && Im.size() == Result.ImIn.size() && Im.type() == Result.ImIn.type() && Im.step == Result.ImIn.step)
+        return Result.ImInKey;
+    return string();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void ShowsScaledImage(Mat Im, string ImWindowName, double dispScale, int dispMode, const ImageCalculatorParams &Params, ImageCalculatorResult &Result)
+{
+    ScopedTimer Timer(Result.Timings, "display");
+    if(Im.empty())
+    {
+        AddInfo(Result, "Empty Image to show");
+        return;
+    }
+
+    double minDisp = 0.0;
+    double maxDisp = 0.0;
+    if(dispMode > 0)
+    {
+        GetDisplayRange(Im, dispMode, Params, &minDisp, &maxDisp, DisplayKey(Im, Result));
+        AddInfo(Result, "range " + NumberToString(minDisp) + " - " + NumberToString(maxDisp));
+    }
+    AddImageToShow(Result, ImWindowName, RenderForDisplay(Im, dispScale, dispMode, minDisp, maxDisp));
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void ShowsScaledImage(Mat Im, Mat Mask, string ImWindowName, double dispScale, int dispMode, const ImageCalculatorParams &Params, ImageCalculatorResult &Result)
+{
+    ScopedTimer Timer(Result.Timings, "display");
+    if(Im.empty())
+    {
+        AddInfo(Result, "Empty Image to show");
+        return;
+    }
+
+    double minDisp = 0.0;
+    double maxDisp = 0.0;
+    if(dispMode > 0)
+    {
+        GetDisplayRange(Im, Mask, dispMode, Params, &minDisp, &maxDisp);
+        AddInfo(Result, "range " + NumberToString(minDisp) + " - " + NumberToString(maxDisp));
+    }
+    AddImageToShow(Result, ImWindowName, RenderForDisplay(Im, dispScale, dispMode, minDisp, maxDisp));
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void SaveScaledImage(Mat Im, string FileName, double dispScale, int dispMode, const ImageCalculatorParams &Params, ImageCalculatorResult &Result)
+{
+    ScopedTimer Timer(Result.Timings, "display");
+    if(Im.empty())
+    {
+        AddInfo(Result, "Empty Image to save");
+        return;
+    }
+
+    double minDisp = 0.0;
+    double maxDisp = 0.0;
+    if(dispMode > 0)
+        GetDisplayRange(Im, dispMode, Params, &minDisp, &maxDisp, DisplayKey(Im, Result));
+    AddFileToSave(Result, FileName, RenderForDisplay(Im, dispScale, dispMode, minDisp, maxDisp));
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void SaveScaledImage(Mat Im, Mat Mask, string FileName, double dispScale, int dispMode, const ImageCalculatorParams &Params, ImageCalculatorResult &Result)
+{
+    ScopedTimer Timer(Result.Timings, "display");
+    if(Im.empty())
+    {
+        AddInfo(Result, "Empty Image to save");
+        return;
+    }
+
+    double minDisp = 0.0;
+    double maxDisp = 0.0;
+    if(dispMode > 0)
+    {
+        GetDisplayRange(Im, Mask, dispMode, Params, &minDisp, &maxDisp);
+        AddInfo(Result, "range " + NumberToString(minDisp) + " - " + NumberToString(maxDisp));
+    }
+    AddFileToSave(Result, FileName, RenderForDisplay(Im, dispScale, dispMode, minDisp, maxDisp));
+}
+//------------------------------------------------------------------------------------------------------------------------------
+//          Modes
+//------------------------------------------------------------------------------------------------------------------------------
+bool ReadImage(const ImageCalculatorParams &Params, ImageCalculatorResult &Result, ImageCache *Cache)
+{
+    int flags;
+    if(Params.loadAnydepth)
+        flags = CV_LOAD_IMAGE_ANYDEPTH;
+    else
+        flags = IMREAD_COLOR;
+
+    path FileNamePath(Result.FileName);
+    string extension = algorithm::to_lower_copy(FileNamePath.extension().string());
+    bool isTiff = extension == ".tif" || extension == ".tiff";
+
+    boost::system::error_code ec;
+    Result.inputFileBytes = file_size(FileNamePath, ec);
+    if(ec)
+        Result.inputFileBytes = 0;
+
+    CachedImage Image;
+    if(!Cache || !Cache->Get(Result.FileName, flags, Image))
+    {
+        ScopedTimer Timer(Result.Timings, "decode");
+        Image.Im = imread(Result.FileName, flags);
+        if(isTiff && !Image.Im.empty())
+            Image.tiffResolutionValid = GetTiffProperties(Result.FileName, Image.xRes, Image.yRes);
+        if(Cache)
+            Cache->Put(Result.FileName, flags, Image);
+    }
+    Result.ImIn = Image.Im;
+    Result.ImInKey = Result.FileName + "|" + to_string((long long)last_write_time(FileNamePath, ec)) + "|" +
+                     to_string(Result.inputFileBytes) + "|" + to_string(flags);
+    if(Result.ImIn.empty())
+    {
+        AddInfo(Result, "improper file");
+        return 0;
+    }
+    if(Cancelled(Result))
+        return 0;
+
+    Result.resizeScale = Params.resizeScale;
+    Result.xPixSizeOut = Params.xPixSizeOut;
+
+    if(isTiff)
+    {
+        Result.xPixelSize = 1.0/(double)Image.xRes;
+        if(!Params.keepRequestedPixelSize)
+            Result.xPixSizeOut = Result.xPixelSize / Params.resizeScale;
+        else
+            Result.resizeScale = Result.xPixelSize / Params.xPixSizeOut;
+    }
+    else
+    {
+        Result.xPixelSize = 1.0;
+    }
+
+    if(Params.showTiffInfo)
+        AddInfo(Result, TiffFilePropetiesAsText(Result.FileName));
+
+    if(Params.showMatInfo)
+        AddInfo(Result, MatPropetiesAsText(Result.ImIn));
+
+    if(Params.showInput)
+        ShowsScaledImage(Result.ImIn, "Input Image", Params.displayScale, 0, Params, Result);
+    if(Params.showInputModyfied)
+        ShowsScaledImage(Result.ImIn, "Input Image PC", Params.displayScale, Params.displayRange, Params, Result);
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// 1 for an annotation pixel. The blue / green test is the original rule for red drawn on a gray image.
+inline uchar AnnotationPixel(int B, int G, int R, int rule, int keyB, int keyG, int keyR, int tolerance)
+{
+    switch(rule)
+    {
+    case 1:
+        return (B != G) || (G != R);
+    case 2:
+        return abs(B - keyB) <= tolerance && abs(G - keyG) <= tolerance && abs(R - keyR) <= tolerance;
+    default:
+        return B != G;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// 8UC3 in, 0/1 mask out: 16U, or 8U for annotationMaskBits 8 and 1. 16 pixels per step
+// with the OpenCV universal intrinsics, rows in parallel.
+Mat RoiFromRed(Mat ImIn, const ImageCalculatorParams &Params)
+{
+    int maskType = Params.annotationMaskBits == 16 ? CV_16U : CV_8U;
+    Mat ImOut(ImIn.size(), maskType);
+    int maxX = ImIn.cols;
+    int rule = Params.annotationRule;
+    uchar keyB = saturate_cast<uchar>(Params.annotationKeyB);
+    uchar keyG = saturate_cast<uchar>(Params.annotationKeyG);
+    uchar keyR = saturate_cast<uchar>(Params.annotationKeyR);
+    uchar tolerance = saturate_cast<uchar>(Params.annotationTolerance);
+
+    parallel_for_(Range(0, ImIn.rows), [&](const Range &Rows)
+    {
+        for(int y = Rows.start; y < Rows.end; y++)
+        {
+            const uchar *wImIn = ImIn.ptr<uchar>(y);
+            uchar *wImOut8 = maskType == CV_8U ? ImOut.ptr<uchar>(y) : 0;
+            ushort *wImOut16 = maskType == CV_16U ? ImOut.ptr<ushort>(y) : 0;
+            int x = 0;
+#if CV_SIMD128
+            v_uint8x16 One = v_setall_u8(1);
+            v_uint8x16 KeyB = v_setall_u8(keyB);
+            v_uint8x16 KeyG = v_setall_u8(keyG);
+            v_uint8x16 KeyR = v_setall_u8(keyR);
+            v_uint8x16 Tolerance = v_setall_u8(tolerance);
+            for(; x <= maxX - 16; x += 16)
+            {
+                v_uint8x16 B, G, R, Annotation;
+                v_load_deinterleave(wImIn + 3 * x, B, G, R);
+                if(rule == 1)
+                    Annotation = (B != G) | (G != R);
+                else if(rule == 2)
+                    Annotation = (v_absdiff(B, KeyB) <= Tolerance) & (v_absdiff(G, KeyG) <= Tolerance) & (v_absdiff(R, KeyR) <= Tolerance);
+                else
+                    Annotation = B != G;
+                Annotation = Annotation & One;
+                if(wImOut8)
+                    v_store(wImOut8 + x, Annotation);
+                else
+                {
+                    v_uint16x8 Low, High;
+                    v_expand(Annotation, Low, High);
+                    v_store(wImOut16 + x, Low);
+                    v_store(wImOut16 + x + 8, High);
+                }
+            }
+#endif
+            for(; x < maxX; x++)
+            {
+                uchar annotation = AnnotationPixel(wImIn[3 * x], wImIn[3 * x + 1], wImIn[3 * x + 2], rule, keyB, keyG, keyR, tolerance);
+                if(wImOut8)
+                    wImOut8[x] = annotation;
+                else
+                    wImOut16[x] = annotation;
+            }
+        }
+    });
+    return ImOut;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void TiffRoiFromRed(const ImageCalculatorParams &Params, ImageCalculatorResult &Result)
+{
+    Mat ImIn = Result.ImIn;
+    if(ImIn.empty())
+    {
+        AddInfo(Result, "Empty Image");
+        return;
+    }
+
+    if(ImIn.depth() != CV_8U)
+    {
+        AddInfo(Result, "Improper image type");
+        return;
+    }
+    if(ImIn.channels() != 3)
+    {
+        AddInfo(Result, "Iproper number of channels");
+        return;
+    }
+
+    Mat ImOut;
+    {
+        ScopedTimer Timer(Result.Timings, "roi from red");
+        ImOut = RoiFromRed(ImIn, Params);
+    }
+    Result.ImOut = ImOut;
+
+    if(Params.showOutput)
+    {
+        Mat ImShow = ImOut;
+        if(ImOut.depth() != CV_16U)
+            ImOut.convertTo(ImShow, CV_16U);
+        ShowsScaledImage(ShowRegion(ImShow), "Output Image", Params.displayScale, 0, Params, Result);
+    }
+    if(Params.saveOutput)
+    {
+        path fileToSave = Params.OutFolder;
+        path fileToOpen = Result.FileName;
+        fileToSave.append(fileToOpen.stem().string());
+        AddFileToSave(Result, fileToSave.string() + ".tif", ImOut, Params.annotationMaskBits == 1 ? 1 : 0);
+
+    }
+
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void ImageResize(const ImageCalculatorParams &Params, ImageCalculatorResult &Result)
+{
+    if(Result.ImIn.empty())
+    {
+        AddInfo(Result, "Empty Image");
+        return;
+    }
+    Result.ImOut.release();
+    {
+        ScopedTimer Timer(Result.Timings, "resize");
+        cv::resize(Result.ImIn, Result.ImOut, Size(), Result.resizeScale, Result.resizeScale, Params.resizeInterpolation);
+    }
+    AddInfo(Result, InterpolationToString(Params.resizeInterpolation));
+
+    if(Params.showOutMatInfo)
+        AddInfo(Result, MatPropetiesAsText(Result.ImOut));
+    if(Params.showOutput)
+        ShowsScaledImage(Result.ImOut, "Output Image", Params.displayScale, Params.displayRange, Params, Result);
+
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string KeyPart(double value)
+{
+    return lexical_cast<string>(value) + "|";
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Mat LinearScale(Mat ImIn, const ImageCalculatorParams &Params)
+{
+    Mat ImIn32S;
+    if(Params.plainImage)
+        ImIn32S = Mat::ones(ImIn.size(), CV_32S)*(int32_t)(Params.intensityScale);
+    else
+        ImIn.convertTo(ImIn32S,CV_32S,Params.intensityScale,0);
+    return ImIn32S;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// Noise of pixel i comes from the Philox stream of its noise type at index i, so rows are filled in
+// parallel and the result depends only on the key drawn from RandomEngine, not on the thread count.
+enum NoiseStream
+{
+    GaussNoiseStream = 0,
+    UniformNoiseStream = 1,
+    RicianRealStream = 2,
+    RicianImaginaryStream = 3
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// returns the input untouched when no noise is enabled
+NoiseStageOut LinearAddNoise(Mat ImIn32S, const ImageCalculatorParams &Params, ImageCalculatorResult &Result, boost::minstd_rand &RandomEngine, bool keepNoise)
+{
+    NoiseStageOut Out;
+    if(!Params.addNoise && !Params.addUniformNoise && !Params.addRician)
+    {
+        Out.Im = ImIn32S;
+        return Out;
+    }
+    Mat ImOut = ImIn32S.clone();
+    Mat ImNoise;
+    int maxX = ImOut.cols;
+    int maxY = ImOut.rows;
+    uint32_t noiseSeed = (uint32_t)RandomEngine();
+
+    if(Params.addNoise)
+    {
+        double noiseStd = Params.gaussNoiseSigma;
+        PhiloxKey Key(noiseSeed, GaussNoiseStream);
+        ImNoise = Mat(ImOut.size(), CV_32S);
+        parallel_for_(Range(0, maxY), [&](const Range &Rows)
+        {
+            vector<double> Normals(maxX);
+            for(int y = Rows.start; y < Rows.end; y++)
+            {
+                PhiloxNormals(Key, (uint64_t)y * maxX, maxX, Normals.data());
+                int32_t *wImNoise = ImNoise.ptr<int32_t>(y);
+                int32_t *wImOut = ImOut.ptr<int32_t>(y);
+                for(int x = 0; x < maxX; x++)
+                {
+                    wImNoise[x] = (int32_t)round(Normals[x] * noiseStd);
+                    wImOut[x] += wImNoise[x];
+                }
+            }
+        });
+
+        if(keepNoise)
+            Out.NoiseIms.push_back(ImNoise);
+        ImNoise.release();
+    }
+    if(Cancelled(Result))
+        return Out;
+    if(Params.addUniformNoise)
+    {
+        int32_t noiseStart = min(Params.uniformNoiseStart, Params.uniformNoiseStop);
+        int32_t noiseStop = max(Params.uniformNoiseStart, Params.uniformNoiseStop);
+        PhiloxKey Key(noiseSeed, UniformNoiseStream);
+        ImNoise = Mat(ImOut.size(), CV_32S);
+        parallel_for_(Range(0, maxY), [&](const Range &Rows)
+        {
+            for(int y = Rows.start; y < Rows.end; y++)
+            {
+                int32_t *wImNoise = ImNoise.ptr<int32_t>(y);
+                int32_t *wImOut = ImOut.ptr<int32_t>(y);
+                PhiloxUniformInts(Key, (uint64_t)y * maxX, maxX, noiseStart, noiseStop, wImNoise);
+                for(int x = 0; x < maxX; x++)
+                    wImOut[x] += wImNoise[x];
+            }
+        });
+
+        if(keepNoise)
+            Out.NoiseIms.push_back(ImNoise);
+        ImNoise.release();
+    }
+    if(Cancelled(Result))
+        return Out;
+
+
+    if(Params.addRician)
+    {
+
+        double ricianS = Params.ricianS;
+        PhiloxKey RealKey(noiseSeed, RicianRealStream);
+        PhiloxKey ImaginaryKey(noiseSeed, RicianImaginaryStream);
+        Mat ImTemp;
+        if(keepNoise)
+            ImOut.copyTo(ImTemp);
+
+        parallel_for_(Range(0, maxY), [&](const Range &Rows)
+        {
+            vector<double> Real(maxX);
+            vector<double> Imaginary(maxX);
+            for(int y = Rows.start; y < Rows.end; y++)
+            {
+                PhiloxNormals(RealKey, (uint64_t)y * maxX, maxX, Real.data());
+                PhiloxNormals(ImaginaryKey, (uint64_t)y * maxX, maxX, Imaginary.data());
+                int32_t *wImOut = ImOut.ptr<int32_t>(y);
+                for(int x = 0; x < maxX; x++)
+                {
+                    double valRNG1 = Real[x] * ricianS + (double)wImOut[x];
+                    double valRNG2 = Imaginary[x] * ricianS;
+                    wImOut[x] = (int32_t)round(sqrt(valRNG1 * valRNG1 + valRNG2 * valRNG2));
+                }
+            }
+        });
+
+        if(keepNoise)
+            Out.NoiseIms.push_back(ImOut - ImTemp);
+        ImTemp.release();
+    }
+    Out.Im = ImOut;
+    return Out;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Mat LinearAddGradient(Mat ImIn32S, const ImageCalculatorParams &Params)
+{
+    if(!Params.addGradient)
+        return ImIn32S;
+
+    Mat ImOut = ImIn32S.clone();
+    int32_t *wImOut = (int32_t *)ImOut.data;
+    int maxX = ImOut.cols;
+    int maxY = ImOut.rows;
+    double gradCoeff = Params.gradNominator / Params.gradDenominator;
+    for(int y = 0; y < maxY; y++)
+    {
+        for(int x = 0; x < maxX; x++)
+        {
+            double val;
+            switch(Params.gradientDirection)
+            {
+            case 1:
+                val = y * gradCoeff;
+                break;
+            case 2:
+                val = (x + y) * gradCoeff;
+                break;
+            default:
+                val = x * gradCoeff;
+                break;
+            }
+
+            if(val < 0.0)
+                val = 0.0;
+            if(val > 65535.0)
+                val = 65535.0;
+            *wImOut += (int32_t)val;
+            wImOut ++;
+        }
+    }
+    return ImOut;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Mat LinearOffsetTo16U(Mat ImIn32S, const ImageCalculatorParams &Params)
+{
+    Mat ImOut = ImIn32S + (int32_t)round(Params.intOffset);
+    ImOut.convertTo(ImOut,CV_16U,1.0,0.0);
+    return ImOut;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// One row of scale -> noise -> gradient -> offset -> 16U, the same arithmetic as the staged functions.
+// Disabled features and the input read of a plain image are compiled out, noise of a row is generated
+// into the row buffers first.
+template<class T, bool plain, bool gauss, bool uniform, bool rician, bool gradient>
+void LinearFusedRows(const Mat &ImIn, Mat &ImOut, const ImageCalculatorParams &Params, uint32_t noiseSeed, const Range &Rows)
+{
+    int maxX = ImIn.cols;
+    double intensityScale = Params.intensityScale;
+    int32_t plainValue = (int32_t)(Params.intensityScale);
+    double noiseStd = Params.gaussNoiseSigma;
+    int32_t noiseStart = min(Params.uniformNoiseStart, Params.uniformNoiseStop);
+    int32_t noiseStop = max(Params.uniformNoiseStart, Params.uniformNoiseStop);
+    double ricianS = Params.ricianS;
+    double gradCoeff = Params.gradNominator / Params.gradDenominator;
+    int gradX = Params.gradientDirection != 1;
+    int gradY = Params.gradientDirection == 1 || Params.gradientDirection == 2;
+    int32_t offset = (int32_t)round(Params.intOffset);
+
+    vector<double> Normals(gauss ? maxX : 0);
+    vector<int32_t> Uniforms(uniform ? maxX : 0);
+    vector<double> Real(rician ? maxX : 0);
+    vector<double> Imaginary(rician ? maxX : 0);
+
+    for(int y = Rows.start; y < Rows.end; y++)
+    {
+        uint64_t first = (uint64_t)y * maxX;
+        if(gauss)
+            PhiloxNormals(PhiloxKey(noiseSeed, GaussNoiseStream), first, maxX, Normals.data());
+        if(uniform)
+            PhiloxUniformInts(PhiloxKey(noiseSeed, UniformNoiseStream), first, maxX, noiseStart, noiseStop, Uniforms.data());
+        if(rician)
+        {
+            PhiloxNormals(PhiloxKey(noiseSeed, RicianRealStream), first, maxX, Real.data());
+            PhiloxNormals(PhiloxKey(noiseSeed, RicianImaginaryStream), first, maxX, Imaginary.data());
+        }
+
+        const T *wImIn = ImIn.ptr<T>(y);
+        uint16_t *wImOut = ImOut.ptr<uint16_t>(y);
+        for(int x = 0; x < maxX; x++)
+        {
+            int32_t val;
+            if(plain)
+                val = plainValue;
+            else
+                val = saturate_cast<int32_t>(wImIn[x] * intensityScale);
+            if(gauss)
+                val = saturate_cast<int32_t>((int64_t)val + (int32_t)round(Normals[x] * noiseStd));
+            if(uniform)
+                val = saturate_cast<int32_t>((int64_t)val + Uniforms[x]);
+            if(rician)
+            {
+                double valRNG1 = Real[x] * ricianS + (double)val;
+                double valRNG2 = Imaginary[x] * ricianS;
+                val = (int32_t)round(sqrt(valRNG1 * valRNG1 + valRNG2 * valRNG2));
+            }
+            if(gradient)
+            {
+                double gradVal = (gradX * x + gradY * y) * gradCoeff;
+                if(gradVal < 0.0)
+                    gradVal = 0.0;
+                if(gradVal > 65535.0)
+                    gradVal = 65535.0;
+                val += (int32_t)gradVal;
+            }
+            wImOut[x] = saturate_cast<uint16_t>((int64_t)val + offset);
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+template<class T, bool gauss, bool uniform, bool rician, bool gradient>
+void LinearFusedSelectPlain(const Mat &ImIn, Mat &ImOut, const ImageCalculatorParams &Params, uint32_t noiseSeed, const Range &Rows)
+{
+    if(Params.plainImage)
+        LinearFusedRows<T, true, gauss, uniform, rician, gradient>(ImIn, ImOut, Params, noiseSeed, Rows);
+    else
+        LinearFusedRows<T, false, gauss, uniform, rician, gradient>(ImIn, ImOut, Params, noiseSeed, Rows);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// bands of rows in parallel, a cancel request skips the bands not yet started
+template<class T, bool gauss, bool uniform, bool rician>
+void LinearFusedSelectGradient(const Mat &ImIn, Mat &ImOut, const ImageCalculatorParams &Params, uint32_t noiseSeed,
+                               const ImageCalculatorResult &Result)
+{
+    const int bandHeight = 64;
+    int bandsCount = (ImIn.rows + bandHeight - 1) / bandHeight;
+    parallel_for_(Range(0, bandsCount), [&](const Range &Bands)
+    {
+        for(int band = Bands.start; band < Bands.end; band++)
+        {
+            if(Cancelled(Result))
+                return;
+            Range Rows(band * bandHeight, min((band + 1) * bandHeight, ImIn.rows));
+            if(Params.addGradient)
+                LinearFusedSelectPlain<T, gauss, uniform, rician, true>(ImIn, ImOut, Params, noiseSeed, Rows);
+            else
+                LinearFusedSelectPlain<T, gauss, uniform, rician, false>(ImIn, ImOut, Params, noiseSeed, Rows);
+        }
+    });
+}
+//------------------------------------------------------------------------------------------------------------------------------
+template<class T, bool gauss, bool uniform>
+void LinearFusedSelectRician(const Mat &ImIn, Mat &ImOut, const ImageCalculatorParams &Params, uint32_t noiseSeed,
+                             const ImageCalculatorResult &Result)
+{
+    if(Params.addRician)
+        LinearFusedSelectGradient<T, gauss, uniform, true>(ImIn, ImOut, Params, noiseSeed, Result);
+    else
+        LinearFusedSelectGradient<T, gauss, uniform, false>(ImIn, ImOut, Params, noiseSeed, Result);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+template<class T, bool gauss>
+void LinearFusedSelectUniform(const Mat &ImIn, Mat &ImOut, const ImageCalculatorParams &Params, uint32_t noiseSeed,
+                              const ImageCalculatorResult &Result)
+{
+    if(Params.addUniformNoise)
+        LinearFusedSelectRician<T, gauss, true>(ImIn, ImOut, Params, noiseSeed, Result);
+    else
+        LinearFusedSelectRician<T, gauss, false>(ImIn, ImOut, Params, noiseSeed, Result);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+template<class T>
+void LinearFusedSelectGauss(const Mat &ImIn, Mat &ImOut, const ImageCalculatorParams &Params, uint32_t noiseSeed,
+                            const ImageCalculatorResult &Result)
+{
+    if(Params.addNoise)
+        LinearFusedSelectUniform<T, true>(ImIn, ImOut, Params, noiseSeed, Result);
+    else
+        LinearFusedSelectUniform<T, false>(ImIn, ImOut, Params, noiseSeed, Result);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// Whole linear operation in one read and one write per pixel, no intermediate 32S images and no noise
+// images. Single channel 8U and 16U only, returns an empty Mat for other inputs.
+Mat LinearOperationFused(Mat ImIn, const ImageCalculatorParams &Params, const ImageCalculatorResult &Result, boost::minstd_rand &RandomEngine)
+{
+    Mat ImOut;
+    if(ImIn.channels() != 1 || (ImIn.depth() != CV_8U && ImIn.depth() != CV_16U))
+        return ImOut;
+
+    uint32_t noiseSeed = 0;
+    if(Params.addNoise || Params.addUniformNoise || Params.addRician)
+        noiseSeed = (uint32_t)RandomEngine();
+
+    ImOut.create(ImIn.size(), CV_16U);
+    if(ImIn.depth() == CV_8U)
+        LinearFusedSelectGauss<uint8_t>(ImIn, ImOut, Params, noiseSeed, Result);
+    else
+        LinearFusedSelectGauss<uint16_t>(ImIn, ImOut, Params, noiseSeed, Result);
+    return ImOut;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// Runs as scale -> noise -> gradient -> offset. With a memo each stage is reused as long as its own
+// parameters and everything upstream are unchanged, display and histogram options recompute nothing.
+void ImageLinearOperation(const ImageCalculatorParams &Params, ImageCalculatorResult &Result, boost::minstd_rand &RandomEngine, StageMemo *Memo)
+{
+    Mat ImIn = Result.ImIn;
+    if(ImIn.empty())
+    {
+        AddInfo(Result, "Empty Image");
+        return;
+    }
+
+    Mat ImOut;
+    // without a memo and without histograms no intermediate image is needed
+    if(!Memo && !Params.showHist)
+    {
+        ScopedTimer Timer(Result.Timings, "linear fused");
+        ImOut = LinearOperationFused(ImIn, Params, Result, RandomEngine);
+        if(Cancelled(Result))
+            return;
+    }
+
+    if(ImOut.empty())
+    {
+        string Key;
+        if(Memo)
+            Key = Memo->InputKey(Result.FileName, ImIn) + "|";
+
+        Key += KeyPart(Params.plainImage) + KeyPart(Params.intensityScale);
+        Mat ImIn32S;
+        if(!Memo || !Memo->LinearScaled.Get(Key, ImIn32S))
+        {
+            ScopedTimer Timer(Result.Timings, "linear scale");
+            ImIn32S = LinearScale(ImIn, Params);
+            if(Memo)
+                Memo->LinearScaled.Put(Key, ImIn32S);
+        }
+
+        if(Params.showHist)
+        {
+            ScopedTimer HistTimer(Result.Timings, "histogram");
+            HistogramInteger ImInHist;
+
+            ImInHist.FromMat32S(ImIn32S);
+            AddHistogramToShow(ImInHist, "Intensity histogram Input", Params, Result);
+            ImInHist.Release();
+        }
+
+        Key += KeyPart(Params.addNoise) + KeyPart(Params.gaussNoiseSigma) +
+               KeyPart(Params.addUniformNoise) + KeyPart(Params.uniformNoiseStart) + KeyPart(Params.uniformNoiseStop) +
+               KeyPart(Params.addRician) + KeyPart(Params.ricianS);
+        NoiseStageOut Noisy;
+        if(!Memo || !Memo->LinearNoise.Get(Key, Noisy))
+        {
+            ScopedTimer Timer(Result.Timings, "noise");
+            Noisy = LinearAddNoise(ImIn32S, Params, Result, RandomEngine, Memo || Params.showHist);
+            if(Cancelled(Result))
+                return;
+            if(Memo)
+                Memo->LinearNoise.Put(Key, Noisy);
+        }
+
+        if(Params.showHist)
+        {
+            for(Mat &ImNoise : Noisy.NoiseIms)
+            {
+                ScopedTimer HistTimer(Result.Timings, "histogram");
+                HistogramInteger IntensityHist;
+
+                IntensityHist.FromMat32S(ImNoise);
+                AddHistogramToShow(IntensityHist, "Intensity histogram Noise", Params, Result);
+
+                IntensityHist.Release();
+            }
+        }
+        if(Cancelled(Result))
+            return;
+
+        Key += KeyPart(Params.addGradient) + KeyPart(Params.gradientDirection) +
+               KeyPart(Params.gradNominator) + KeyPart(Params.gradDenominator);
+        Mat ImGradient;
+        if(!Memo || !Memo->LinearGradient.Get(Key, ImGradient))
+        {
+            ScopedTimer Timer(Result.Timings, "gradient");
+            ImGradient = LinearAddGradient(Noisy.Im, Params);
+            if(Memo)
+                Memo->LinearGradient.Put(Key, ImGradient);
+        }
+
+        Key += KeyPart(Params.intOffset);
+        if(!Memo || !Memo->LinearOut.Get(Key, ImOut))
+        {
+            ScopedTimer Timer(Result.Timings, "offset");
+            ImOut = LinearOffsetTo16U(ImGradient, Params);
+            if(Memo)
+                Memo->LinearOut.Put(Key, ImOut);
+        }
+    }
+    Result.ImOut = ImOut;
+
+    if(Params.showOutput)
+        ShowsScaledImage(ImOut, "Output Image", Params.displayScale, Params.displayRange, Params, Result);
+
+    if(Params.showHist)
+    {
+        ScopedTimer HistTimer(Result.Timings, "histogram");
+        HistogramInteger IntensityHist;
+
+        IntensityHist.FromMat16U(ImOut);
+        AddHistogramToShow(IntensityHist, "Intensity histogram Output", Params, Result);
+
+        IntensityHist.Release();
+    }
+    if(Params.saveOutput)
+    {
+        path fileToOpen(Result.FileName);
+        string OutFileName = fileToOpen.stem().string();
+        path fileToSave = Params.OutFolder;
+        if(Params.addNoise)
+        {
+            OutFileName += "GN";
+            OutFileName += NumberToString(Params.gaussNoiseSigma, 1);
+        }
+        if(Params.addRician)
+        {
+            OutFileName += "RN";
+            OutFileName += NumberToString(Params.ricianS, 1);
+        }
+        if(Params.addUniformNoise)
+        {
+            OutFileName += "UN";
+            OutFileName += to_string(Params.uniformNoiseStart);
+            OutFileName += "-";
+            OutFileName += to_string(Params.uniformNoiseStop);
+        }
+        if(Params.addGradient)
+        {
+            OutFileName += "Gr";
+        }
+
+        OutFileName += ".tiff";
+        fileToSave.append(OutFileName);
+
+        AddFileToSave(Result, fileToSave.string(), ImOut);
+    }
+
+
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string RoiShapeName(const ImageCalculatorParams &Params)
+{
+    string Out;
+    switch(Params.roiShape)
+    {
+    case 1:
+        Out += "Cir";
+        break;
+    default:
+        Out += "Rct";
+        break;
+    }
+    Out += to_string(Params.roiSize);
+    return Out;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string RoiNormName(int roiNorm)
+{
+    switch(roiNorm)
+    {
+    case 1:
+        return "NormMeanPM3STD";
+    case 2:
+        return "Norm1_99Perc";
+    default:
+        return "NormMinMax";
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void ClearSpan(Mat &Mask, const RoiSpan &Span, Point Origin)
+{
+    uint16_t *wMask = Mask.ptr<uint16_t>(Span.y + Origin.y);
+    fill(wMask + Span.xStart + Origin.x, wMask + Span.xEnd + Origin.x, (uint16_t)0);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// 16U mask of the whole image, RoiIndex::CropLabel on the pixels outside every ROI
+Mat BackgroundMask(const RoiIndex &Index)
+{
+    Mat Mask(Index.MaskSize(), CV_16U, Scalar(RoiIndex::CropLabel));
+    for(int roiNr = 1; roiNr <= Index.MaxRoiNr(); roiNr++)
+        Index.ForEachSpan(roiNr, [&](const RoiSpan &Span){ ClearSpan(Mask, Span, Point(0, 0)); });
+    return Mask;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// the same for the grid, rasterised in bands of rows so only the mask itself is full size
+Mat BackgroundMask(const RoiGrid &Grid)
+{
+    const int bandHeight = 256;
+    Size ImSize = Grid.MaskSize();
+    Mat Mask(ImSize, CV_16U, Scalar(RoiIndex::CropLabel));
+    RoiIndex BandIndex;
+    vector<int> RoiNrs;
+    for(int y = 0; y < ImSize.height; y += bandHeight)
+    {
+        Rect Band(0, y, ImSize.width, min(bandHeight, ImSize.height - y));
+        Grid.TileIndex(Band, BandIndex, RoiNrs);
+        for(int label = 1; label <= BandIndex.MaxRoiNr(); label++)
+            BandIndex.ForEachSpan(label, [&](const RoiSpan &Span){ ClearSpan(Mask, Span, Band.tl()); });
+    }
+    return Mask;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// image and mask cut to the bounding box of roiNr, so masked histograms and norms touch only that ROI;
+// the mask has RoiIndex::CropLabel on the ROI. roiNr 0 is the background, the whole image with the
+// pixels outside every ROI, and a ROI the index does not have gives a single background pixel.
+void CutToRoi(Mat Im, const RoiIndex &Index, int roiNr, Mat &RoiIm, Mat &RoiMask)
+{
+    if(roiNr == 0)
+    {
+        RoiIm = Im;
+        RoiMask = BackgroundMask(Index);
+        return;
+    }
+    if(!Index.Contains(roiNr))
+    {
+        RoiIm = Im(Rect(0, 0, 1, 1)).clone();
+        RoiMask = Mat::zeros(1, 1, CV_16U);
+        return;
+    }
+    RoiIm = Im(Index.BoundingBox(roiNr)).clone();
+    RoiMask = Index.CropMask(roiNr);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void CutToRoi(Mat Im, const RoiGrid &Grid, int roiNr, Mat &RoiIm, Mat &RoiMask)
+{
+    if(roiNr == 0)
+    {
+        RoiIm = Im;
+        RoiMask = BackgroundMask(Grid);
+        return;
+    }
+    RoiCropStageOut Crop = CropRoi(Im, Grid, roiNr);
+    if(Crop.SmallIm.empty())
+    {
+        RoiIm = Im(Rect(0, 0, 1, 1)).clone();
+        RoiMask = Mat::zeros(1, 1, CV_16U);
+        return;
+    }
+    RoiIm = Crop.SmallIm;
+    RoiMask = Crop.SmallMask;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// One MaZda ROI per label 1 .. maxRoiNr, each covering only its bounding box and filled from the index,
+// ROIs built in parallel. A label missing from the mask gives an empty ROI, so ROI numbers stay equal
+// to the labels. The caller deletes the ROIs.
+vector<MR2DType*> RoisFromMask(const RoiIndex &Index, int maxRoiNr, string Name)
+{
+    vector<MR2DType*> ROIVect(max(maxRoiNr, 0));
+    parallel_for_(Range(0, (int)ROIVect.size()), [&](const Range &Rois)
+    {
+        for(int i = Rois.start; i < Rois.end; i++)
+        {
+            int roiNr = i + 1;
+            Rect Box = Index.BoundingBox(roiNr);
+            int begin[MR2DType::Dimensions];
+            int end[MR2DType::Dimensions];
+            begin[0] = Box.x;
+            begin[1] = Box.y;
+            end[0] = Box.x + max(Box.width, 1) - 1;
+            end[1] = Box.y + max(Box.height, 1) - 1;
+
+            MR2DType *ROI = new MR2DType(begin, end);
+            if(Index.Contains(roiNr))
+            {
+                Mat SmallMask = Index.CropMask(roiNr);
+                const uint16_t *wSmallMask = SmallMask.ptr<uint16_t>(0);
+                MazdaRoiIterator<MR2DType> iterator(ROI);
+                while(! iterator.IsBehind())
+                {
+                    if (*wSmallMask)
+                        iterator.SetPixel();
+                    ++iterator;
+                    wSmallMask++;
+                }
+            }
+            ROI->SetName(Name);
+            ROI->SetColor(RegColorsRGB[i%16]);
+            ROIVect[i] = ROI;
+        }
+    });
+    return ROIVect;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+RoiGrid CreateRoiGrid(Size ImSize, const ImageCalculatorParams &Params)
+{
+    return RoiGrid(ImSize, Params.roiShape, Params.roiSize, Params.roiOffset, Params.roiShift,
+                   Params.reducedRoi, Params.reducedRoiComplement, Params.skipCount);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// the grid with the run length mask of all its ROIs
+RoiMaskStageOut CreateRoiMask(Size ImSize, const ImageCalculatorParams &Params)
+{
+    std::shared_ptr<RoiGrid> Grid = std::make_shared<RoiGrid>(CreateRoiGrid(ImSize, Params));
+
+    RoiMaskStageOut Out;
+    Out.maxRoiNr = Grid->MaxRoiNr();
+    Out.Grid = Grid;
+    Out.Index = std::make_shared<RoiIndex>(Grid->FullIndex());
+    return Out;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// bounding box from the index, only the ROI's box is copied; empty for a missing ROI
+RoiCropStageOut CropRoi(Mat ImIn, const RoiIndex &Index, int roiNr)
+{
+    RoiCropStageOut Out;
+    if(!Index.Contains(roiNr))
+        return Out;
+    ImIn(Index.BoundingBox(roiNr)).copyTo(Out.SmallIm);
+    Out.SmallMask = Index.CropMask(roiNr);
+    return Out;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// only the ROIs around roiNr are rasterised; empty for a missing ROI
+RoiCropStageOut CropRoi(Mat ImIn, const RoiGrid &Grid, int roiNr)
+{
+    RoiCropStageOut Out;
+    Rect Area = Grid.BoundingBox(roiNr);
+    if(Area.area() <= 0)
+        return Out;
+    RoiIndex Index;
+    vector<int> RoiNrs;
+    Grid.TileIndex(Area, Index, RoiNrs);
+    int label = (int)(lower_bound(RoiNrs.begin(), RoiNrs.end(), roiNr) - RoiNrs.begin()) + 1;
+    if(label > (int)RoiNrs.size() || RoiNrs[label - 1] != roiNr || !Index.Contains(label))
+        return Out;
+    ImIn(Index.BoundingBox(label) + Area.tl()).copyTo(Out.SmallIm);
+    Out.SmallMask = Index.CropMask(label);
+    return Out;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// SmallMask as made by CropRoi, ROI pixels set to RoiIndex::CropLabel
+Mat BinRoi(Mat SmallIm, Mat SmallMask, int roiNorm, int binCount)
+{
+    double minNorm = 0.0;
+    double maxNorm = 255.0;
+
+    switch(roiNorm)
+    {
+    case 1:
+        NormParamsMeanP3Std(SmallIm, SmallMask, RoiIndex::CropLabel, &maxNorm, &minNorm);
+        break;
+    case 2:
+        NormParams1to99perc(SmallIm, SmallMask, RoiIndex::CropLabel, &maxNorm, &minNorm);
+        break;
+    default:
+        NormParamsMinMax(SmallIm, SmallMask, RoiIndex::CropLabel, &maxNorm, &minNorm);
+        break;
+    }
+    return CreateNormalisedImage16U(SmallIm,minNorm,maxNorm,binCount);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// Runs as mask -> ROI crop -> binning. With a memo changing the ROI number only re-crops, changing
+// the normalisation only re-bins. The grid is analytic: a selected ROI and the statistics rasterise
+// and convert to 16 bit only the tiles they read. The histogram of the background ROI 0, the display,
+// the ROI bitmap and the .roi export still work on the whole image.
+void CreateROI(const ImageCalculatorParams &Params, ImageCalculatorResult &Result, StageMemo *Memo)
+{
+    Mat ImIn = Result.ImIn;
+    if(ImIn.empty())
+    {
+        AddInfo(Result, "Empty Image");
+        return;
+    }
+    int maxX = ImIn.cols;
+    int maxY = ImIn.rows;
+
+    string InputKey;
+    if(Memo)
+        InputKey = Memo->InputKey(Result.FileName, ImIn) + "|";
+
+    string MaskKey = KeyPart(maxX) + KeyPart(maxY) + KeyPart(Params.roiShape) + KeyPart(Params.roiSize) +
+                     KeyPart(Params.roiOffset) + KeyPart(Params.roiShift) + KeyPart(Params.reducedRoi) +
+                     KeyPart(Params.reducedRoiComplement) + KeyPart(Params.skipCount);
+    RoiMaskStageOut RoiMask;
+    if(!Memo || !Memo->RoiMask.Get(MaskKey, RoiMask))
+    {
+        std::shared_ptr<RoiGrid> Grid = std::make_shared<RoiGrid>(CreateRoiGrid(ImIn.size(), Params));
+        RoiMask.maxRoiNr = Grid->MaxRoiNr();
+        RoiMask.Grid = Grid;
+    }
+    if(!RoiMask.Index && (Params.showOutput || Params.saveRoiBmp || Params.saveRoi))
+    {
+        ScopedTimer Timer(Result.Timings, "roi mask");
+        RoiMask.Index = std::make_shared<RoiIndex>(RoiMask.Grid->FullIndex());
+    }
+    if(Memo)
+        Memo->RoiMask.Put(MaskKey, RoiMask);
+    const RoiGrid &Grid = *RoiMask.Grid;
+    int maxRoiNr = RoiMask.maxRoiNr;
+
+    Result.maxRoiNr = maxRoiNr;
+    if(Cancelled(Result))
+        return;
+
+    AddInfo(Result, "Max ROI Nr " + to_string(maxRoiNr));
+
+    // the GUI limits the ROI number spin box to maxRoiNr
+    int selectedRoiNr = Params.roiNr;
+    if(selectedRoiNr > maxRoiNr)
+        selectedRoiNr = maxRoiNr;
+
+    // the full size mask only for display
+    Mat Mask;
+    if(Params.showOutput || Params.saveRoiBmp)
+        Mask = RoiMask.Index->ToDisplayMat();
+
+    if(Params.showOutput)
+    {
+        ShowsScaledImage(ShowRegion(Mask), "Output Image", Params.displayScale, 0, Params, Result);
+    }
+
+
+    if(Params.saveRoiBmp)
+    {
+        path fileToSave = Params.OutFolder;
+        string RoiName = "ROI_";
+        RoiName += RoiShapeName(Params);
+        RoiName += "Cnt";
+        RoiName += to_string(maxRoiNr);
+        RoiName +=  ".bmp";
+        fileToSave.append(RoiName);
+        AddFileToSave(Result, fileToSave.string(), ShowRegion(Mask));
+    }
+
+    if(Params.showHist || Params.saveRoiHistogram || Params.saveStatistics)
+    {
+        ScopedTimer HistTimer(Result.Timings, "histogram");
+        HistogramInteger IntensityHist;
+
+        // Only the crop of a selected ROI is converted to 16 bit. ROI 0, the background, is not cropped:
+        // HistogramInteger is filled from one image, so it takes a full size 16 bit mask and, for input
+        // other than 16 bit, a full size 16 bit copy; a 16 bit input is used in place.
+        Mat RoiIm, RoiMaskIm;
+        CutToRoi(ImIn, Grid, selectedRoiNr, RoiIm, RoiMaskIm);
+        if(RoiIm.depth() != CV_16U)
+            RoiIm.convertTo(RoiIm, CV_16U);
+        if(Params.fixRangeHistogram)
+            IntensityHist.FromMat16ULimit(RoiIm, RoiMaskIm, RoiIndex::CropLabel,
+                                          Params.minHist,
+                                          Params.maxHist);
+        else
+            IntensityHist.FromMat16U(RoiIm,RoiMaskIm,RoiIndex::CropLabel);
+
+        if(Params.showHist)
+        {
+            AddHistogramToShow(IntensityHist, "Intensity histogram Output", Params, Result);
+        }
+
+
+        if(Params.saveRoiHistogram)
+        {
+            path fileToOpen(Result.FileName);
+            string RoiImName = fileToOpen.stem().string();
+
+            path fileToSave = Params.OutFolder;
+            RoiImName += RoiShapeName(Params);
+            RoiImName += "Cnt";
+            RoiImName += to_string(maxRoiNr);
+            RoiImName += "Nr";
+            RoiImName += to_string(selectedRoiNr);
+            RoiImName +=  ".txt";
+            fileToSave.append(RoiImName);
+
+            AddTextToSave(Result, fileToSave.string(), IntensityHist.GetString());
+
+        }
+
+
+        if(Params.saveStatistics)
+        {
+            Result.OutStringStat = IntensityHist.StatisticStringOut();
+            AddInfo(Result, Result.OutStringStat);
+        }
+        IntensityHist.Release();
+    }
+
+    // every ROI of the image in one pass, collected by the batch into RoiStatistics.txt
+    if(Params.saveStatistics)
+    {
+        ScopedTimer Timer(Result.Timings, "roi statistics");
+        double histMin = Params.minHist;
+        double histMax = Params.maxHist;
+        if(!Params.fixRangeHistogram)
+        {
+            // the range of the image as the 16 bit conversion of every tile saturates it
+            minMaxLoc(ImIn, &histMin, &histMax);
+            histMin = min(max(round(histMin), 0.0), 65535.0);
+            histMax = min(max(round(histMax), 0.0), 65535.0);
+        }
+        // A dense grid gets coarser histograms, down to a single bin, where P1 and P99 fall back to the
+        // ROI minimum: up to 2^26 ROIs the histograms hold at most 2^26 counters (256 MB), beyond that
+        // one counter each. The table adds about 100 bytes per ROI plus the heap block of each histogram.
+        int histogramBins = (int)min(histMax - histMin + 1.0, 4096.0);
+        histogramBins = max(min(histogramBins, (1 << 26) / max(maxRoiNr, 1)), 1);
+
+        // tiles are converted one at a time, no full size copy of the image is made
+        LabelStatisticsTable Labels;
+        ComputeLabelStatistics(Grid, [&](Rect Tile)
+                               {
+                                   Mat Tile16U;
+                                   ImIn(Tile).convertTo(Tile16U, CV_16U);
+                                   return Tile16U;
+                               },
+                               Params.roiTileSize, Labels, histogramBins, histMin, histMax);
+        Result.OutStringRoiStat = LabelStatisticsAsText(path(Result.FileName).filename().string(), Labels);
+    }
+
+    bool roiCropNeeded = Params.showNormalisedRoi || Params.saveNormalisedRoiImage || Params.showBinnedRoi || Params.saveBinnedRoiImage;
+    bool roiFound = roiCropNeeded && Grid.Contains(selectedRoiNr);
+    if(roiCropNeeded && !roiFound)
+        AddInfo(Result, "No ROI " + to_string(selectedRoiNr));
+    if(roiFound)
+    {
+        int roiNr = selectedRoiNr;
+        string CropKey = InputKey + MaskKey + KeyPart(roiNr);
+        RoiCropStageOut RoiCrop;
+        if(!Memo || !Memo->RoiCrop.Get(CropKey, RoiCrop))
+        {
+            ScopedTimer Timer(Result.Timings, "roi crop");
+            RoiCrop = CropRoi(ImIn, Grid, roiNr);
+            if(Memo)
+                Memo->RoiCrop.Put(CropKey, RoiCrop);
+        }
+        Mat SmallIm = RoiCrop.SmallIm;
+        Mat SmallMask = RoiCrop.SmallMask;
+
+        if(Params.showNormalisedRoi)
+            ShowsScaledImage(SmallIm, SmallMask, "ROI small", Params.roiScale, Params.displayRange, Params, Result);
+
+        if(Params.showBinnedRoi || Params.saveBinnedRoiImage)
+        {
+
+            Mat ImToShow;
+
+            int binCount = (int)pow(2,Params.roiBitPerPix);
+
+            string BinnedKey = CropKey + KeyPart(Params.roiNorm) + KeyPart(binCount);
+            Mat ImBinned;
+            if(!Memo || !Memo->RoiBinned.Get(BinnedKey, ImBinned))
+            {
+                ScopedTimer Timer(Result.Timings, "roi binning");
+                ImBinned = BinRoi(SmallIm, SmallMask, Params.roiNorm, binCount);
+                if(Memo)
+                    Memo->RoiBinned.Put(BinnedKey, ImBinned);
+            }
+
+            ImToShow = ShowImage16PseudoColor(ImBinned,0.0,binCount-1);
+
+            if (Params.roiScale != 1.0)
+                cv::resize(ImToShow,ImToShow,Size(), Params.roiScale, Params.roiScale, INTER_AREA);
+
+            if(Params.showBinnedRoi)
+                AddImageToShow(Result, "Im Binned", ImToShow);
+
+            if(Params.saveBinnedRoiImage)
+            {
+                path fileToOpen(Result.FileName);
+                string RoiImName = fileToOpen.stem().string();
+
+                path fileToSave = Params.OutFolder;
+                RoiImName += RoiShapeName(Params);
+                RoiImName += "Cnt";
+                RoiImName += to_string(maxRoiNr);
+                RoiImName += "Nr";
+                RoiImName += to_string(selectedRoiNr);
+                RoiImName += RoiNormName(Params.roiNorm);
+                RoiImName += "BpP";
+                RoiImName += to_string(Params.roiBitPerPix);
+                RoiImName +=  ".bmp";
+                fileToSave.append(RoiImName);
+                AddFileToSave(Result, fileToSave.string(), ImToShow);
+            }
+
+            if(Params.showHist || Params.saveBinnedRoiHist)
+            {
+                ScopedTimer HistTimer(Result.Timings, "histogram");
+                HistogramInteger IntensityHist;
+
+                IntensityHist.FromMat16ULimit(ImBinned,SmallMask,RoiIndex::CropLabel,0,binCount+1);
+
+                if(Params.showHist)
+                {
+                    AddHistogramToShow(IntensityHist, "Intensity histogram ROI Binned", Params, Result);
+                }
+
+
+                if(Params.saveBinnedRoiHist)
+                {
+                    path fileToOpen(Result.FileName);
+                    string RoiImName = fileToOpen.stem().string();
+
+                    path fileToSave = Params.OutFolder;
+                    RoiImName += RoiShapeName(Params);
+                    RoiImName += "Cnt";
+                    RoiImName += to_string(maxRoiNr);
+                    RoiImName += "Nr";
+                    RoiImName += to_string(selectedRoiNr);
+                    RoiImName += RoiNormName(Params.roiNorm);
+                    RoiImName += "BpP";
+                    RoiImName += to_string(Params.roiBitPerPix);
+                    RoiImName +=  ".txt";
+                    fileToSave.append(RoiImName);
+
+                    AddTextToSave(Result, fileToSave.string(), IntensityHist.GetString());
+
+                }
+                IntensityHist.Release();
+            }
+
+        }
+
+        if(Params.saveNormalisedRoiImage)
+        {
+            path fileToOpen(Result.FileName);
+            string RoiImName = fileToOpen.stem().string();
+
+            path fileToSave = Params.OutFolder;
+            RoiImName += RoiShapeName(Params);
+            RoiImName += "Cnt";
+            RoiImName += to_string(maxRoiNr);
+
+
+            RoiImName += "Nr";
+            RoiImName += to_string(selectedRoiNr);
+            switch(Params.displayRange)
+            {
+            case 1:
+                RoiImName += "NormFixed";
+                break;
+            case 2:
+                RoiImName += "NormMeanPM3STD";
+                break;
+            case 3:
+                RoiImName += "Norm1_99Perc";
+                break;
+            case 4:
+                RoiImName += "NormMinMax";
+                break;
+            default:
+                RoiImName += "NormNone";
+                break;
+            }
+            RoiImName += "BpP";
+            RoiImName += to_string(Params.roiBitPerPix);
+
+            RoiImName +=  ".bmp";
+            fileToSave.append(RoiImName);
+            SaveScaledImage(SmallIm, SmallMask, fileToSave.string(), Params.roiScale, Params.displayRange, Params, Result);
+        }
+    }
+
+
+
+    path fileToOpen(Result.FileName);
+    string RoiName = fileToOpen.stem().string();
+
+    if(Params.saveRoi)
+    {
+        ScopedTimer Timer(Result.Timings, "roi export");
+        vector <MR2DType*> ROIVect = RoisFromMask(*RoiMask.Index, maxRoiNr, RoiName);
+
+        path fileToSave = Params.OutFolder;
+        RoiName += RoiShapeName(Params);
+        RoiName += "Cnt";
+        RoiName += to_string(maxRoiNr);
+        RoiName +=  ".roi";
+        fileToSave.append(RoiName);
+
+        if(!Cancelled(Result))
+            MazdaRoiIO<MR2DType>::Write(fileToSave.string(), &ROIVect, NULL);
+        while(ROIVect.size() > 0)
+        {
+             delete ROIVect.back();
+             ROIVect.pop_back();
+        }
+    }
+
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// One MzGenerator command line; append adds to OutFile, withOptions gives the options file
+string MaZdaCommand(const ImageCalculatorParams &Params, path ImageFileName, string OutFile, bool append, bool withOptions)
+{
+    string out = Params.MaZdaFileLocation;
+    out += " -m roi -i ";
+    out += Params.MaZdaInFilesFolder;
+    out += ImageFileName.filename().string();
+    out += " -r ";
+    out += Params.MaZdaROIFolder;
+    out += ImageFileName.stem().string();
+    out += ".roi";
+    if (append)
+    {
+        out += " -a ";
+    }
+    out += " -o ";
+    out += OutFile;
+
+    if (withOptions)
+    {
+        out += " -f ";
+        out += Params.MaZdaOptionsDir;
+        out += Params.MaZdaOptionsFile;
+        out += ".";
+        out += Params.MaZdaOptionsExtension;
+    }
+    return out;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// the table the script appends to; MaZdaOutFileName uses Windows backslashes and is relative to OutFolder
+path MaZdaOutputFile(const ImageCalculatorParams &Params)
+{
+    string OutFileName = Params.MaZdaOutFileName + Params.MaZdaOptionsFile + ".cvs";
+    replace(OutFileName.begin(), OutFileName.end(), '\\', '/');
+    path OutFile(OutFileName);
+    if(OutFile.is_relative())
+        OutFile = absolute(path(Params.OutFolder)) / OutFile;
+    return OutFile;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string MaZdaShardFile(const ImageCalculatorParams &Params, int fileNr)
+{
+    path ShardFile = absolute(path(Params.OutFolder));
+    ShardFile /= Params.MaZdaScriptFileName + "_" + Params.MaZdaOptionsFile + "_shards";
+    ostringstream Name;
+    Name << setfill('0') << setw(6) << fileNr << ".cvs";
+    ShardFile /= Name.str();
+    return ShardFile.string();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void CreateMaZdaScript(const ImageCalculatorParams &Params, ImageCalculatorResult &Result)
+{
+    Mat ImIn = Result.ImIn;
+    if(ImIn.empty())
+    {
+        AddInfo(Result, "Empty Image");
+        return;
+    }
+    RoiIndex Index;
+    Index.Reset(ImIn.size());
+    Index.Finish();
+
+    int maxX = ImIn.cols;
+    int maxY = ImIn.rows;
+
+    path ROIFile = Params.ImageFolder;
+    path ImageFileName(Result.FileName);
+    ROIFile.append("/" + Params.MaZdaROIFolder + ImageFileName.stem().string() + ".roi");
+
+    vector<string> RoiNames;
+    if(exists(ROIFile))
+    {
+        ScopedTimer Timer(Result.Timings, "load roi");
+        Index = LoadRoiIndex(ROIFile, Size(maxX, maxY), &RoiNames);
+
+        AddInfo(Result, "Valid Roi");
+    }
+    else
+    {
+        AddInfo(Result, "No Roi For The Frame");
+
+    }
+
+    if(Params.showOutput)
+    {
+        double minDisp = 0.0;
+        double maxDisp = 255.0;
+        GetDisplayRange(ImIn, Params.displayRange, Params, &minDisp, &maxDisp, Result.ImInKey);
+
+        Mat ImShowGray = ShowImage16Gray(ImIn,minDisp,maxDisp);
+        Mat ImShow = ShowSolidRegionOnImage(Index.Contour().ToDisplayMat(),ImShowGray);
+        ShowsScaledImage(ImShow, "Output Image", Params.displayScale, 0, Params, Result);
+    }
+    if(Params.showHist)
+    {
+        ImIn.convertTo(Result.ImOut,CV_16U);
+        ScopedTimer HistTimer(Result.Timings, "histogram");
+        HistogramInteger IntensityHist;
+
+        Mat RoiIm, RoiMaskIm;
+        CutToRoi(Result.ImOut, Index, 2, RoiIm, RoiMaskIm);
+        IntensityHist.FromMat16U(RoiIm,RoiMaskIm,RoiIndex::CropLabel);
+        AddHistogramToShow(IntensityHist, "Intensity histogram Output", Params, Result);
+
+        IntensityHist.Release();
+    }
+
+    if(Params.MaZdaInProcess)
+    {
+        ScopedTimer Timer(Result.Timings, "first order features");
+        vector<FirstOrderFeatures> Features;
+        if(ComputeFirstOrderFeatures(Index, ImIn, Features))
+            Result.OutStringFeatures = FirstOrderFeaturesAsText(ImageFileName.filename().string(), RoiNames, Features);
+        else
+            AddInfo(Result, "No Features For The Frame");
+        return;
+    }
+
+    Result.OutString = MaZdaCommand(Params, ImageFileName, Params.MaZdaOutFileName + Params.MaZdaOptionsFile + ".cvs",
+                                    Result.fileNr != 0, Result.fileNr == 0) + "\n";
+    if(Params.MaZdaRunJobs)
+    {
+        // every job writes its own shard with the options, the shards are merged after the batch
+        Result.MaZdaJob.ShardFile = MaZdaShardFile(Params, Result.fileNr);
+        Result.MaZdaJob.Command = MaZdaCommand(Params, ImageFileName, "\"" + Result.MaZdaJob.ShardFile + "\"", 0, 1);
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void ViewRoi(const ImageCalculatorParams &Params, ImageCalculatorResult &Result, StageMemo *Memo)
+{
+    Mat ImIn = Result.ImIn;
+    if(ImIn.empty())
+    {
+        AddInfo(Result, "Empty Image");
+        return ;
+    }
+    int maxX = ImIn.cols;
+    int maxY = ImIn.rows;
+
+    path ROIFile = Params.ImageFolder;
+    path ImageFileName(Result.FileName);
+    ROIFile.append("/" + Params.ViewROIFolder + ImageFileName.stem().string() + ".roi");
+
+    RoiMaskStageOut RoiMask;
+    if(exists(ROIFile))
+    {
+        string MaskKey = ROIFile.string() + "|" + to_string((long long)last_write_time(ROIFile)) + "|" +
+                         KeyPart(maxX) + KeyPart(maxY);
+        if(!Memo || !Memo->ViewRoiMask.Get(MaskKey, RoiMask))
+        {
+            ScopedTimer Timer(Result.Timings, "load roi");
+            std::shared_ptr<RoiIndex> Index = std::make_shared<RoiIndex>(LoadRoiIndex(ROIFile, Size(maxX, maxY)));
+            RoiMask.maxRoiNr = Index->MaxRoiNr();
+            RoiMask.Index = Index;
+            if(Memo)
+                Memo->ViewRoiMask.Put(MaskKey, RoiMask);
+        }
+        Result.maxRoiNr = RoiMask.maxRoiNr;
+        AddInfo(Result, "Valid Roi");
+    }
+    else
+    {
+        AddInfo(Result, "No Roi For The Frame");
+        return;
+    }
+    if(Cancelled(Result))
+        return;
+
+    int viewRoiNr = Params.viewRoiNr;
+
+    // one crop of the viewed ROI serves the histograms, the normalisation and the binning
+    bool binnedNeeded = Params.viewRoiShowBinned || Params.viewSaveBinnedRoiImage || Params.viewSaveRoiBinnedHistogram;
+    Mat RoiIm, RoiMaskIm;
+    if(Params.showHist || binnedNeeded)
+        CutToRoi(ImIn, *RoiMask.Index, viewRoiNr, RoiIm, RoiMaskIm);
+
+    if(Params.showOutput || Params.viewSaveBinnedRoiImage)
+    {
+
+        double minDisp, maxDisp;
+        GetDisplayRange(ImIn, Params.displayRange, Params, &minDisp, &maxDisp, Result.ImInKey);
+
+        Mat ImShowGray = ShowImage16Gray(ImIn,minDisp,maxDisp);
+        Mat ImShow;
+        if(Params.showRoiOnImage)
+            ImShow = ShowSolidRegionOnImage(RoiMask.Index->Contour().ToDisplayMat(),ImShowGray);
+        else
+            ImShow = ImShowGray;
+        if(Params.showOutput)
+            ShowsScaledImage(ImShow, "Output Image", Params.displayScale, 0, Params, Result);
+        if(Params.viewSaveBinnedRoiImage)
+        {
+            path fileToOpen(Result.FileName);
+            string RoiImName = fileToOpen.stem().string();
+
+            path fileToSave = Params.OutFolder;
+            RoiImName += "Nr";
+            RoiImName += to_string(Params.viewRoiNr);
+            RoiImName += "NormNone";
+
+            RoiImName +=  ".bmp";
+
+            fileToSave.append(RoiImName);
+            SaveScaledImage(ImShow, fileToSave.string(), Params.displayScale, 0, Params, Result);
+
+
+        }
+    }
+
+    if(Params.showHist || Params.viewSaveRoiBinnedHistogram)
+    {
+        Mat ImTemp;
+        RoiIm.convertTo(ImTemp,CV_16U);
+        ScopedTimer HistTimer(Result.Timings, "histogram");
+        HistogramInteger IntensityHist;
+        if(Params.fixRangeHistogram)
+            IntensityHist.FromMat16ULimit(ImTemp,RoiMaskIm,RoiIndex::CropLabel, Params.minHist,Params.maxHist);
+        else
+            IntensityHist.FromMat16U(ImTemp,RoiMaskIm,RoiIndex::CropLabel);
+
+        if(Params.showHist)
+            AddHistogramToShow(IntensityHist, "Intensity histogram Input", Params, Result);
+
+
+        if(Params.viewSaveRoiBinnedHistogram)
+        {
+            path fileToOpen(Result.FileName);
+            string RoiImName = fileToOpen.stem().string();
+
+            path fileToSave = Params.OutFolder;
+            RoiImName += "Nr";
+            RoiImName += to_string(Params.viewRoiNr);
+            RoiImName += "NormNone";
+
+            RoiImName +=  ".txt";
+
+            fileToSave.append(RoiImName);
+
+            AddTextToSave(Result, fileToSave.string(), IntensityHist.GetString());
+        }
+        IntensityHist.Release();
+    }
+
+    if(binnedNeeded)
+    {
+        Mat ImToShow;
+
+        // only the crop is binned, the background ROI 0 crops to the whole image
+        int binCount = (int)pow(2,Params.viewRoiBitPerPixel);
+        Mat ImBinned = BinRoi(RoiIm, RoiMaskIm, Params.viewRoiNorm, binCount);
+
+        ImToShow = ShowImage16PseudoColor(ImBinned,0.0,binCount-1);
+
+        if (Params.displayScale != 1.0)
+            cv::resize(ImToShow,ImToShow,Size(), Params.displayScale, Params.displayScale, INTER_AREA);
+
+        if(Params.viewRoiShowBinned)
+            AddImageToShow(Result, "Im Binned", ImToShow);
+
+
+
+        if(Params.viewSaveBinnedRoiImage)
+        {
+            path fileToOpen(Result.FileName);
+            string RoiImName = fileToOpen.stem().string();
+
+            RoiImName += "Nr";
+            RoiImName += to_string(Params.viewRoiNr);
+            RoiImName += RoiNormName(Params.viewRoiNorm);
+            RoiImName += "BpP";
+            RoiImName += to_string(Params.viewRoiBitPerPixel);
+            RoiImName +=  ".bmp";
+            path fileToSave(Params.OutFolder);
+            fileToSave.append(RoiImName);
+            AddFileToSave(Result, fileToSave.string(), ImToShow);
+        }
+
+        if(Params.showHist || Params.viewSaveRoiBinnedHistogram)
+        {
+            ScopedTimer HistTimer(Result.Timings, "histogram");
+            HistogramInteger IntensityHist;
+
+            IntensityHist.FromMat16ULimit(ImBinned, RoiMaskIm, RoiIndex::CropLabel,0 , binCount-1);
+
+            if(Params.showHist)
+            {
+                AddHistogramToShow(IntensityHist, "Intensity histogram ROI Binned", Params, Result);
+            }
+
+
+            if(Params.viewSaveRoiBinnedHistogram)
+            {
+                path fileToOpen(Result.FileName);
+                string RoiImName = fileToOpen.stem().string();
+
+                path fileToSave = Params.OutFolder;
+                RoiImName += "Nr";
+                RoiImName += to_string(Params.viewRoiNr);
+                RoiImName += RoiNormName(Params.viewRoiNorm);
+                RoiImName += "BpP";
+                RoiImName += to_string(Params.viewRoiBitPerPixel);
+                RoiImName +=  ".txt";
+
+                fileToSave.append(RoiImName);
+
+                AddTextToSave(Result, fileToSave.string(), IntensityHist.GetString());
+            }
+            IntensityHist.Release();
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+//          Processing of a single file and of the whole folder
+//------------------------------------------------------------------------------------------------------------------------------
+void RunMode(const ImageCalculatorParams &Params, ImageCalculatorResult &Result, boost::minstd_rand &RandomEngine, StageMemo *Memo)
+{
+    switch(Params.operationMode)
+    {
+    case 0:
+        TiffRoiFromRed(Params, Result);
+        break;
+    case 1:
+        ImageResize(Params, Result);
+        break;
+    case 2:
+        ImageLinearOperation(Params, Result, RandomEngine, Memo);
+        break;
+    case 3:
+        CreateROI(Params, Result, Memo);
+        break;
+    case 4:
+        CreateMaZdaScript(Params, Result);
+        break;
+    case 5:
+        ViewRoi(Params, Result, Memo);
+        break;
+    default:
+
+            break;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void ModeSelect(const ImageCalculatorParams &Params, ImageCalculatorResult &Result, boost::minstd_rand &RandomEngine, ImageCache *Cache, StageMemo *Memo)
+{
+    ReadImage(Params, Result, Cache);
+    if(Cancelled(Result))
+        return;
+    RunMode(Params, Result, RandomEngine, Memo);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// batch runs only produce files and text, building the display images would only waste time
+void DisableDisplay(ImageCalculatorParams &Params)
+{
+    Params.showInput = 0;
+    Params.showInputModyfied = 0;
+    Params.showOutput = 0;
+    Params.showHist = 0;
+    Params.showNormalisedRoi = 0;
+    Params.showBinnedRoi = 0;
+    Params.viewRoiShowBinned = 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+int BatchThreadCount(int requestedThreadCount, int filesCount)
+{
+    int threadCount = requestedThreadCount;
+    if(threadCount <= 0)
+        threadCount = (int)std::thread::hardware_concurrency();
+    if(threadCount <= 0)
+        threadCount = 1;
+    if(threadCount > filesCount)
+        threadCount = filesCount;
+    return threadCount;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void SaveBatchOutputs(const ImageCalculatorParams &Params, string CumulatedStatString, string OutString, string CumulatedRoiStatString,
+                      string CumulatedFeaturesString)
+{
+    switch(Params.operationMode)
+    {
+    case 3:
+        {
+            path textOutFile = Params.OutFolder;
+            textOutFile.append("HistStatistics.txt");
+
+            std::ofstream out (textOutFile.string());
+            out << CumulatedStatString;
+            out.close();
+        }
+        if(Params.saveStatistics)
+        {
+            path textOutFile = Params.OutFolder;
+            textOutFile.append("RoiStatistics.txt");
+
+            std::ofstream out (textOutFile.string());
+            out << CumulatedRoiStatString;
+            out.close();
+        }
+        break;
+    case 4:
+        if(Params.MaZdaInProcess)
+        {
+            path textOutFile = MaZdaOutputFile(Params);
+            boost::system::error_code Error;
+            create_directories(textOutFile.parent_path(), Error);
+
+            std::ofstream out (textOutFile.string());
+            out << CumulatedFeaturesString;
+            out.close();
+        }
+        else
+        {
+            path textOutFile = Params.OutFolder;
+            textOutFile.append(Params.MaZdaScriptFileName + "_"+ Params.MaZdaOptionsFile + ".bat");
+
+            std::ofstream out (textOutFile.string());
+            out << OutString;
+            out.close();
+        }
+        break;
+
+    default:
+
+            break;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// Runs the MaZda commands of the batch concurrently in the output folder, each into its own shard,
+// and merges the shards in the file list order into the file the serial script appends to.
+bool RunMaZdaJobs(const ImageCalculatorParams &Params, const vector<CommandJob> &Jobs, std::ostream &Log)
+{
+    if(Jobs.empty())
+        return 1;
+    path ShardFolder = path(Jobs.front().ShardFile).parent_path();
+    boost::system::error_code Error;
+    create_directories(ShardFolder, Error);
+
+    vector<CommandJobResult> Results;
+    bool allSucceeded = RunCommandJobs(Jobs, Params.jobCount, Params.jobTimeout, Params.jobRetries,
+                                       absolute(path(Params.OutFolder)).string(), Results);
+    Log << FailedCommandJobsAsText(Jobs, Results);
+
+    path OutFile = MaZdaOutputFile(Params);
+    create_directories(OutFile.parent_path(), Error);
+    vector<string> ShardFiles;
+    for(const CommandJob &Job : Jobs)
+        ShardFiles.push_back(Job.ShardFile);
+    if(!MergeShards(ShardFiles, OutFile.string(), 1))
+        allSucceeded = 0;
+
+    if(allSucceeded)
+        remove_all(ShardFolder, Error);
+    return allSucceeded;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string BatchReportAsText(const BatchReport &Report)
+{
+    ostringstream Out;
+    double seconds = Report.seconds > 0.0 ? Report.seconds : 1e-9;
+    Out << Report.filesCount << " files processed, " << Report.readThreadCount << " read threads, " << Report.threadCount << " compute threads\n";
+    Out << fixed << setprecision(2);
+    Out << Report.seconds << " s, " << Report.filesCount / seconds << " images/s, "
+        << Report.inputFileBytes / seconds / 1048576.0 << " MB/s\n";
+    Out << StageTimesAsText(Report.Timings);
+    return Out.str();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string JsonString(string Text)
+{
+    string Out = "\"";
+    for(char c : Text)
+    {
+        if(c == '"' || c == '\\')
+            Out += '\\';
+        Out += c;
+    }
+    return Out + "\"";
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// BatchReport_<date>_<time>.json in the output folder, one per run so builds can be compared
+bool SaveBatchReport(const ImageCalculatorParams &Params, const BatchReport &Report)
+{
+    std::time_t now = std::time(0);
+    char TimeStamp[32];
+    strftime(TimeStamp, sizeof(TimeStamp), "%Y%m%d_%H%M%S", localtime(&now));
+
+    path ReportFile = Params.OutFolder;
+    ReportFile.append(string("BatchReport_") + TimeStamp + ".json");
+    std::ofstream Out(ReportFile.string());
+    if(!Out.is_open())
+        return 0;
+
+    double seconds = Report.seconds > 0.0 ? Report.seconds : 1e-9;
+    Out << setprecision(9);
+    Out << "{\n";
+    Out << "  \"timeStamp\": " << JsonString(TimeStamp) << ",\n";
+    Out << "  \"build\": " << JsonString(string(__DATE__) + " " + __TIME__
+#ifdef __VERSION__
+                                        + " " + __VERSION__
+#endif
+                                        ) << ",\n";
+    Out << "  \"operationMode\": " << Params.operationMode << ",\n";
+    Out << "  \"imageFolder\": " << JsonString(Params.ImageFolder) << ",\n";
+    Out << "  \"regexImageFile\": " << JsonString(Params.RegexImageFile) << ",\n";
+    Out << "  \"threadCount\": " << Report.threadCount << ",\n";
+    Out << "  \"readThreadCount\": " << Report.readThreadCount << ",\n";
+    Out << "  \"filesCount\": " << Report.filesCount << ",\n";
+    Out << "  \"seconds\": " << Report.seconds << ",\n";
+    Out << "  \"inputBytes\": " << Report.inputFileBytes << ",\n";
+    Out << "  \"imagesPerSecond\": " << Report.filesCount / seconds << ",\n";
+    Out << "  \"megabytesPerSecond\": " << Report.inputFileBytes / seconds / 1048576.0 << ",\n";
+    Out << "  \"stages\": [";
+    bool first = 1;
+    for(auto &Item : Report.Timings)
+    {
+        Out << (first ? "\n" : ",\n");
+        Out << "    {\"name\": " << JsonString(Item.first) << ", \"seconds\": " << Item.second.seconds
+            << ", \"calls\": " << Item.second.calls << "}";
+        first = 0;
+    }
+    Out << "\n  ]\n}\n";
+    Out.close();
+    return !Out.fail();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// Batch pipeline: reader threads decode ahead, compute workers run the mode, a writer thread saves
+// the output files. The stages are connected by bounded queues, so at most about
+// 2 * queueSize images are held in memory while the disk and the cores are busy at the same time.
+// Each file gets its own result and random engine seeded from randomSeed and the file number,
+// so the output does not depend on the thread count. Results are collected in the file list order.
+// Returns 0 when MaZda jobs were run and one of them failed.
+bool ProcessFileList(const ImageCalculatorParams &Params, const vector<string> &FileList, std::ostream &Log, BatchReport *Report,
+                     const std::atomic<bool> *CancelRequested, std::function<void(int, const std::string &)> OnFileDone)
+{
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    path ImageFolder(Params.ImageFolder);
+    int filesCount = (int)FileList.size();
+
+    int threadCount = BatchThreadCount(Params.threadCount, filesCount);
+    int readThreadCount = BatchThreadCount(Params.readThreadCount, filesCount);
+    int queueSize = Params.queueSize;
+    if(queueSize <= 0)
+        queueSize = 2 * threadCount;
+
+    BoundedQueue<ImageCalculatorResult> DecodedQueue(queueSize);
+    BoundedQueue<ImageCalculatorResult> EncodeQueue(queueSize);
+
+    vector<ImageCalculatorResult> Results(filesCount);
+    vector<char> ResultReady(filesCount, 0);
+    std::mutex ResultMutex;
+    std::condition_variable ResultReadyCondition;
+
+    std::atomic<int> nextFileNr(0);
+    std::atomic<int> activeReaders(readThreadCount);
+    std::atomic<int> activeWorkers(threadCount);
+
+    auto Reader = [&]()
+    {
+        while(1)
+        {
+            int fileNr = nextFileNr++;
+            if(fileNr >= filesCount)
+                break;
+
+            path fileToOpen = ImageFolder;
+            fileToOpen.append(FileList[fileNr]);
+
+            ImageCalculatorResult Result;
+            Result.FileName = fileToOpen.string();
+            Result.fileNr = fileNr;
+            Result.cancelRequested = CancelRequested;
+            // files not yet read when a cancel comes still pass, empty, so that every file is collected
+            if(Cancelled(Result))
+            {
+                DecodedQueue.Push(std::move(Result));
+                continue;
+            }
+            try
+            {
+                ReadImage(Params, Result);
+            }
+            catch(std::exception &e)
+            {
+                AddInfo(Result, string("Error ") + e.what());
+            }
+            DecodedQueue.Push(std::move(Result));
+        }
+        if(--activeReaders == 0)
+            DecodedQueue.Close();
+    };
+
+    auto Worker = [&]()
+    {
+        ImageCalculatorResult Result;
+        while(DecodedQueue.Pop(Result))
+        {
+            boost::minstd_rand RandomEngine(Params.randomSeed + (unsigned int)Result.fileNr);
+            try
+            {
+                if(!Cancelled(Result))
+                    RunMode(Params, Result, RandomEngine);
+            }
+            catch(std::exception &e)
+            {
+                AddInfo(Result, string("Error ") + e.what());
+            }
+            Result.ImIn.release();
+            Result.ImOut.release();
+            Result.ImagesToShow.clear();
+            EncodeQueue.Push(std::move(Result));
+        }
+        if(--activeWorkers == 0)
+            EncodeQueue.Close();
+    };
+
+    auto Writer = [&]()
+    {
+        ImageCalculatorResult Result;
+        while(EncodeQueue.Pop(Result))
+        {
+            try
+            {
+                SaveResultFiles(Result);
+            }
+            catch(std::exception &e)
+            {
+                AddInfo(Result, string("Error ") + e.what());
+            }
+            int fileNr = Result.fileNr;
+            {
+                std::lock_guard<std::mutex> lock(ResultMutex);
+                Results[fileNr] = std::move(Result);
+                ResultReady[fileNr] = 1;
+            }
+            ResultReadyCondition.notify_one();
+        }
+    };
+
+    vector<std::thread> Threads;
+    for(int i = 0; i < readThreadCount; i++)
+        Threads.push_back(std::thread(Reader));
+    for(int i = 0; i < threadCount; i++)
+        Threads.push_back(std::thread(Worker));
+    if(filesCount > 0)
+        Threads.push_back(std::thread(Writer));
+
+    string CumulatedStatString = StatisticStringHeader();
+    // CreateROI always gathers intensities and at least one histogram bin per ROI
+    string CumulatedRoiStatString = LabelStatisticsHeader(1, 1);
+    string CumulatedFeaturesString = FirstOrderFeaturesHeader();
+    string OutString;
+    vector<CommandJob> MaZdaJobs;
+    BatchReport Totals;
+
+    for(int fileNr = 0; fileNr < filesCount; fileNr++)
+    {
+        ImageCalculatorResult Result;
+        {
+            std::unique_lock<std::mutex> lock(ResultMutex);
+            ResultReadyCondition.wait(lock, [&]{ return ResultReady[fileNr] != 0; });
+            Result = std::move(Results[fileNr]);
+            Results[fileNr] = ImageCalculatorResult();
+        }
+
+        string FileLog = FileList[fileNr] + "\n" + Result.Info;
+        Log << FileLog;
+        if(OnFileDone)
+            OnFileDone(fileNr, FileLog);
+
+        CumulatedStatString += Result.OutStringStat;
+        CumulatedRoiStatString += Result.OutStringRoiStat;
+        CumulatedFeaturesString += Result.OutStringFeatures;
+        OutString += Result.OutString;
+        if(!Result.MaZdaJob.Command.empty())
+            MaZdaJobs.push_back(Result.MaZdaJob);
+        AddStageTimes(Totals.Timings, Result.Timings);
+        Totals.inputFileBytes += Result.inputFileBytes;
+    }
+    for(std::thread &T : Threads)
+        T.join();
+
+    SaveBatchOutputs(Params, CumulatedStatString, OutString, CumulatedRoiStatString, CumulatedFeaturesString);
+    bool cancelled = CancelRequested && CancelRequested->load();
+    bool jobsSucceeded = 0;
+    if(cancelled)
+        Log << "Cancelled, outputs cover the files processed so far, MaZda jobs are not run\n";
+    else
+    {
+        jobsSucceeded = RunMaZdaJobs(Params, MaZdaJobs, Log);
+        if(!jobsSucceeded)
+            Log << "MaZda jobs failed, the shards are kept\n";
+    }
+
+    std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - Start;
+    Totals.filesCount = filesCount;
+    Totals.threadCount = threadCount;
+    Totals.readThreadCount = readThreadCount;
+    Totals.seconds = Elapsed.count();
+    if(!SaveBatchReport(Params, Totals))
+        Log << "cannot save batch report in " << Params.OutFolder << "\n";
+
+    Log << BatchReportAsText(Totals);
+    if(Report)
+        *Report = Totals;
+    return jobsSucceeded;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool ProcessAll(const ImageCalculatorParams &Params, std::ostream &Log, BatchReport *Report)
+{
+    path ImageFolder(Params.ImageFolder);
+    if (!exists(ImageFolder) || !is_directory(ImageFolder))
+    {
+        Log << "Error " << Params.ImageFolder << " is not a directory\n";
+        return 0;
+    }
+    path OutFolder(Params.OutFolder);
+    if (!exists(OutFolder) || !is_directory(OutFolder))
+    {
+        Log << "Error " << Params.OutFolder << " is not a directory\n";
+        return 0;
+    }
+
+    vector<string> FileList;
+    try
+    {
+        FileList = GetImageFileList(Params);
+    }
+    catch(boost::regex_error &)
+    {
+        Log << "Error improper regex " << Params.RegexImageFile << "\n";
+        return 0;
+    }
+
+    return ProcessFileList(Params, FileList, Log, Report);
+}
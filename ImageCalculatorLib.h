@@ -0,0 +1,280 @@
+#ifndef IMAGECALCULATORLIB_H
+#define IMAGECALCULATORLIB_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <atomic>
+#include <functional>
+
+#include <boost/filesystem.hpp>
+#include <boost/random/linear_congruential.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#include "stagetimer.h"
+#include "stagememo.h"
+#include "commandjobs.h"
+
+class ImageCache;
+
+//------------------------------------------------------------------------------------------------------------------------------
+// Processing parameters, one field per MainWindow control. Filled by the GUI from the widgets
+// or by the batch runner from the command line / parameter file.
+//------------------------------------------------------------------------------------------------------------------------------
+struct ImageCalculatorParams
+{
+    int operationMode;
+
+    std::string ImageFolder;
+    std::string OutFolder;
+    std::string RegexImageFile;
+    int minImageWidth;
+    int minImageHeight;
+    int imageBitsPerSample;
+
+    unsigned int randomSeed;
+    int threadCount;
+    int readThreadCount;
+    int queueSize;
+    int imageCacheMB;
+
+    // input
+    bool loadAnydepth;
+    bool showTiffInfo;
+    bool showMatInfo;
+    bool showInput;
+    bool showInputModyfied;
+
+    // display
+    bool showOutput;
+    double displayScale;
+    int displayRange;
+    double fixMinDisp;
+    double fixMaxDisp;
+
+    // histogram
+    bool showHist;
+    int histScaleHeight;
+    int histScaleCoef;
+    int histBarWidth;
+    bool fixRangeHistogram;
+    int minHist;
+    int maxHist;
+
+    bool saveOutput;
+
+    // TiffRoiFromRed
+    int annotationRule;             // 0 blue differs from green, 1 any channel differs, 2 colour key
+    int annotationKeyR;
+    int annotationKeyG;
+    int annotationKeyB;
+    int annotationTolerance;
+    int annotationMaskBits;         // 16, 8 or 1 (packed bilevel TIFF)
+
+    // ImageResize
+    double resizeScale;
+    int resizeInterpolation;
+    bool keepRequestedPixelSize;
+    double xPixSizeOut;
+    bool showOutMatInfo;
+
+    // ImageLinearOperation
+    bool plainImage;
+    double intensityScale;
+    double intOffset;
+    bool addNoise;
+    double gaussNoiseSigma;
+    bool addUniformNoise;
+    int uniformNoiseStart;
+    int uniformNoiseStop;
+    bool addRician;
+    double ricianS;
+    bool addGradient;
+    int gradientDirection;
+    double gradNominator;
+    double gradDenominator;
+
+    // CreateROI
+    int roiShape;
+    int roiSize;
+    int roiOffset;
+    int roiShift;
+    bool reducedRoi;
+    bool reducedRoiComplement;
+    int skipCount;
+    int roiTileSize;                    // side of the tiles the grid statistics are computed on
+    int roiNr;
+    double roiScale;
+    int roiNorm;
+    int roiBitPerPix;
+    bool saveRoi;
+    bool saveRoiBmp;
+    bool saveRoiHistogram;
+    bool saveStatistics;
+    bool showNormalisedRoi;
+    bool saveNormalisedRoiImage;
+    bool showBinnedRoi;
+    bool saveBinnedRoiImage;
+    bool saveBinnedRoiHist;
+
+    // CreateMaZdaScript
+    std::string MaZdaFileLocation;
+    std::string MaZdaInFilesFolder;
+    std::string MaZdaROIFolder;
+    std::string MaZdaOutFileName;
+    std::string MaZdaOptionsFile;
+    std::string MaZdaOptionsDir;
+    std::string MaZdaOptionsExtension;
+    std::string MaZdaScriptFileName;
+    bool MaZdaInProcess;                // first order features computed here instead of the script
+    bool MaZdaRunJobs;                  // run the commands after the batch instead of only writing the script
+    int jobCount;                       // commands running at the same time, 0 for the number of cores
+    double jobTimeout;                  // seconds, 0 for no limit
+    int jobRetries;
+
+    // ViewRoi
+    std::string ViewROIFolder;
+    int viewRoiNr;
+    int viewRoiNorm;
+    int viewRoiBitPerPixel;
+    bool viewRoiShowBinned;
+    bool showRoiOnImage;
+    bool viewSaveBinnedRoiImage;
+    bool viewSaveRoiBinnedHistogram;
+
+    ImageCalculatorParams();
+};
+//------------------------------------------------------------------------------------------------------------------------------
+struct ImageToShow
+{
+    std::string WindowName;
+    cv::Mat Im;
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// output file waiting for the writer, either an image or a text
+struct FileToSave
+{
+    std::string FileName;
+    cv::Mat Im;
+    std::string Text;
+    int bitsPerPixel;               // 1 packs a 0/1 mask into a bilevel TIFF, otherwise imwrite
+
+    FileToSave() : bitsPerPixel(0) {}
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// Everything one image produces. The GUI displays it, the batch runner only collects the strings.
+//------------------------------------------------------------------------------------------------------------------------------
+struct ImageCalculatorResult
+{
+    std::string FileName;
+    int fileNr;
+
+    cv::Mat ImIn;
+    std::string ImInKey;                // file, modification time, size and load flags of ImIn
+    cv::Mat ImOut;
+
+    double xPixelSize;
+    double resizeScale;
+    double xPixSizeOut;
+
+    int maxRoiNr;
+
+    std::string OutString;
+    std::string OutStringStat;
+    std::string OutStringRoiStat;       // one line per ROI, see LabelStatisticsAsText
+    std::string OutStringFeatures;      // one line per ROI, see FirstOrderFeaturesAsText
+    CommandJob MaZdaJob;                // set by CreateMaZdaScript when MaZdaRunJobs
+    std::string Info;
+
+    std::vector<ImageToShow> ImagesToShow;
+    std::vector<FileToSave> FilesToSave;
+
+    StageTimes Timings;
+    uintmax_t inputFileBytes;
+
+    // set by the caller when the parameters changed and the result is no longer needed
+    const std::atomic<bool> *cancelRequested;
+
+    ImageCalculatorResult();
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// Totals of one batch run, stage times are summed over all files and threads.
+//------------------------------------------------------------------------------------------------------------------------------
+struct BatchReport
+{
+    int filesCount;
+    int threadCount;
+    int readThreadCount;
+    double seconds;
+    uintmax_t inputFileBytes;
+    StageTimes Timings;
+
+    BatchReport();
+};
+//------------------------------------------------------------------------------------------------------------------------------
+RoiIndex LoadRoiIndex(boost::filesystem::path InputFile, cv::Size ImSize, std::vector<std::string> *RoiNames = 0);
+cv::Mat LoadROI(boost::filesystem::path InputFile,int maxX, int maxY);
+std::string InterpolationToString(int interpolationNr);
+bool GetTiffProperties(std::string FileName, float &xRes, float &yRes);
+bool SaveBilevelTiff(std::string FileName, cv::Mat Mask);
+cv::Mat CreateNormalisedImage16U(cv::Mat ImIn, double minNorm, double maxNorm, int nrOfBins);
+
+std::vector<std::string> GetImageFileList(const ImageCalculatorParams &Params);
+
+bool SetParam(ImageCalculatorParams &Params, std::string Key, std::string Value);
+bool LoadParamsFile(ImageCalculatorParams &Params, boost::filesystem::path ParamsFile, std::string *Error);
+
+void GetDisplayRange(cv::Mat Im, int dispMode, const ImageCalculatorParams &Params, double *minDisp, double *maxDisp,
+                     const std::string &ImageKey = std::string());
+// Mask is a crop mask of RoiIndex, only its RoiIndex::CropLabel pixels are measured
+void GetDisplayRange(cv::Mat Im, cv::Mat Mask, int dispMode, const ImageCalculatorParams &Params, double *minDisp, double *maxDisp);
+cv::Mat RenderForDisplay(cv::Mat Im, double dispScale, int dispMode, double minDisp, double maxDisp);
+void ShowsScaledImage(cv::Mat Im, std::string ImWindowName, double dispScale, int dispMode, const ImageCalculatorParams &Params, ImageCalculatorResult &Result);
+void ShowsScaledImage(cv::Mat Im, cv::Mat Mask, std::string ImWindowName, double dispScale, int dispMode, const ImageCalculatorParams &Params, ImageCalculatorResult &Result);
+void SaveScaledImage(cv::Mat Im, std::string FileName, double dispScale, int dispMode, const ImageCalculatorParams &Params, ImageCalculatorResult &Result);
+void SaveScaledImage(cv::Mat Im, cv::Mat Mask, std::string FileName, double dispScale, int dispMode, const ImageCalculatorParams &Params, ImageCalculatorResult &Result);
+
+bool Cancelled(const ImageCalculatorResult &Result);
+std::string StageTimesAsText(const StageTimes &Times);
+
+// pixel kernels of the modes, public for the benchmark
+cv::Mat RoiFromRed(cv::Mat ImIn, const ImageCalculatorParams &Params);
+cv::Mat LinearScale(cv::Mat ImIn, const ImageCalculatorParams &Params);
+NoiseStageOut LinearAddNoise(cv::Mat ImIn32S, const ImageCalculatorParams &Params, ImageCalculatorResult &Result, boost::minstd_rand &RandomEngine, bool keepNoise);
+cv::Mat LinearAddGradient(cv::Mat ImIn32S, const ImageCalculatorParams &Params);
+cv::Mat LinearOffsetTo16U(cv::Mat ImIn32S, const ImageCalculatorParams &Params);
+cv::Mat LinearOperationFused(cv::Mat ImIn, const ImageCalculatorParams &Params, const ImageCalculatorResult &Result, boost::minstd_rand &RandomEngine);
+RoiMaskStageOut CreateRoiMask(cv::Size ImSize, const ImageCalculatorParams &Params);
+RoiGrid CreateRoiGrid(cv::Size ImSize, const ImageCalculatorParams &Params);
+RoiCropStageOut CropRoi(cv::Mat ImIn, const RoiIndex &Index, int roiNr);
+RoiCropStageOut CropRoi(cv::Mat ImIn, const RoiGrid &Grid, int roiNr);
+cv::Mat BinRoi(cv::Mat SmallIm, cv::Mat SmallMask, int roiNorm, int binCount);
+
+bool ReadImage(const ImageCalculatorParams &Params, ImageCalculatorResult &Result, ImageCache *Cache = 0);
+void TiffRoiFromRed(const ImageCalculatorParams &Params, ImageCalculatorResult &Result);
+void ImageResize(const ImageCalculatorParams &Params, ImageCalculatorResult &Result);
+void ImageLinearOperation(const ImageCalculatorParams &Params, ImageCalculatorResult &Result, boost::minstd_rand &RandomEngine, StageMemo *Memo = 0);
+void CreateROI(const ImageCalculatorParams &Params, ImageCalculatorResult &Result, StageMemo *Memo = 0);
+void CreateMaZdaScript(const ImageCalculatorParams &Params, ImageCalculatorResult &Result);
+void ViewRoi(const ImageCalculatorParams &Params, ImageCalculatorResult &Result, StageMemo *Memo = 0);
+
+void RunMode(const ImageCalculatorParams &Params, ImageCalculatorResult &Result, boost::minstd_rand &RandomEngine, StageMemo *Memo = 0);
+void ModeSelect(const ImageCalculatorParams &Params, ImageCalculatorResult &Result, boost::minstd_rand &RandomEngine, ImageCache *Cache = 0, StageMemo *Memo = 0);
+void SaveResultFiles(ImageCalculatorResult &Result);
+void DisableDisplay(ImageCalculatorParams &Params);
+int BatchThreadCount(int requestedThreadCount, int filesCount);
+void SaveBatchOutputs(const ImageCalculatorParams &Params, std::string CumulatedStatString, std::string OutString, std::string CumulatedRoiStatString,
+                      std::string CumulatedFeaturesString);
+bool RunMaZdaJobs(const ImageCalculatorParams &Params, const std::vector<CommandJob> &Jobs, std::ostream &Log);
+std::string BatchReportAsText(const BatchReport &Report);
+bool SaveBatchReport(const ImageCalculatorParams &Params, const BatchReport &Report);
+// CancelRequested stops reading and processing further files, the outputs then cover the files done
+// and no MaZda job is run. OnFileDone gets the log of each file in file order, on the calling thread.
+// Returns 0 when cancelled or when a MaZda job failed.
+bool ProcessFileList(const ImageCalculatorParams &Params, const std::vector<std::string> &FileList, std::ostream &Log, BatchReport *Report = 0,
+                     const std::atomic<bool> *CancelRequested = 0,
+                     std::function<void(int, const std::string &)> OnFileDone = std::function<void(int, const std::string &)>());
+bool ProcessAll(const ImageCalculatorParams &Params, std::ostream &Log, BatchReport *Report = 0);
+
+#endif // IMAGECALCULATORLIB_H
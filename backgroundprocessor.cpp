@@ -0,0 +1,102 @@
+#include "backgroundprocessor.h"
+
+#include <ctime>
+
+using namespace std;
+
+//------------------------------------------------------------------------------------------------------------------------------
+BackgroundProcessor::BackgroundProcessor(std::function<void()> OnResultReady) :
+    OnResultReady(OnResultReady),
+    stop(0),
+    requestPending(0),
+    requestNr(0),
+    pendingFileNr(0),
+    cancelRequested(0),
+    resultReady(0),
+    RandomEngine((unsigned int)time(0)),
+    DecodedImages(0)
+{
+    WorkerThread = std::thread(&BackgroundProcessor::Run, this);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+BackgroundProcessor::~BackgroundProcessor()
+{
+    {
+        std::lock_guard<std::mutex> lock(RequestMutex);
+        stop = 1;
+        cancelRequested = 1;
+    }
+    RequestCondition.notify_one();
+    WorkerThread.join();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void BackgroundProcessor::Submit(const ImageCalculatorParams &Params, string FileName, int fileNr)
+{
+    {
+        std::lock_guard<std::mutex> lock(RequestMutex);
+        PendingParams = Params;
+        PendingFileName = FileName;
+        pendingFileNr = fileNr;
+        requestPending = 1;
+        requestNr++;
+        cancelRequested = 1;
+    }
+    RequestCondition.notify_one();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool BackgroundProcessor::TakeResult(ImageCalculatorResult &Result)
+{
+    std::lock_guard<std::mutex> lock(RequestMutex);
+    if(!resultReady)
+        return 0;
+    Result = std::move(LatestResult);
+    LatestResult = ImageCalculatorResult();
+    resultReady = 0;
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void BackgroundProcessor::Run()
+{
+    while(1)
+    {
+        ImageCalculatorParams Params;
+        ImageCalculatorResult Result;
+        unsigned long thisRequestNr;
+        {
+            std::unique_lock<std::mutex> lock(RequestMutex);
+            RequestCondition.wait(lock, [this]{ return stop || requestPending; });
+            if(stop)
+                return;
+            Params = PendingParams;
+            Result.FileName = PendingFileName;
+            Result.fileNr = pendingFileNr;
+            thisRequestNr = requestNr;
+            requestPending = 0;
+            cancelRequested = 0;
+        }
+        Result.cancelRequested = &cancelRequested;
+        DecodedImages.SetBudget((size_t)Params.imageCacheMB * 1024 * 1024);
+
+        try
+        {
+            ModeSelect(Params, Result, RandomEngine, &DecodedImages, &Stages);
+            if(cancelRequested)
+                continue;
+            SaveResultFiles(Result);
+        }
+        catch(std::exception &e)
+        {
+            Result.Info += string("Error ") + e.what() + "\n";
+        }
+        Result.cancelRequested = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(RequestMutex);
+            if(thisRequestNr != requestNr)
+                continue;
+            LatestResult = std::move(Result);
+            resultReady = 1;
+        }
+        OnResultReady();
+    }
+}
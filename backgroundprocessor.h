@@ -0,0 +1,58 @@
+#ifndef BACKGROUNDPROCESSOR_H
+#define BACKGROUNDPROCESSOR_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#include <boost/random/linear_congruential.hpp>
+
+#include "ImageCalculatorLib.h"
+#include "imagecache.h"
+#include "stagememo.h"
+
+//------------------------------------------------------------------------------------------------------------------------------
+// Runs ModeSelect for the interactive GUI on one worker thread. A new request cancels the one in
+// progress and replaces the one waiting, so only the latest parameters are ever shown.
+// OnResultReady is called on the worker thread, the result is then taken with TakeResult.
+//------------------------------------------------------------------------------------------------------------------------------
+class BackgroundProcessor
+{
+public:
+    explicit BackgroundProcessor(std::function<void()> OnResultReady);
+    ~BackgroundProcessor();
+
+    void Submit(const ImageCalculatorParams &Params, std::string FileName, int fileNr);
+    bool TakeResult(ImageCalculatorResult &Result);
+
+private:
+    void Run();
+
+    std::function<void()> OnResultReady;
+
+    std::mutex RequestMutex;
+    std::condition_variable RequestCondition;
+
+    bool stop;
+    bool requestPending;
+    unsigned long requestNr;
+    ImageCalculatorParams PendingParams;
+    std::string PendingFileName;
+    int pendingFileNr;
+
+    std::atomic<bool> cancelRequested;
+
+    bool resultReady;
+    ImageCalculatorResult LatestResult;
+
+    boost::minstd_rand RandomEngine;
+    ImageCache DecodedImages;
+    StageMemo Stages;
+
+    std::thread WorkerThread;
+};
+
+#endif // BACKGROUNDPROCESSOR_H
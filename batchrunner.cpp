@@ -0,0 +1,81 @@
+#include "batchrunner.h"
+
+#include <iostream>
+#include <string>
+
+#include "ImageCalculatorLib.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------------------------------------------------------
+void PrintUsage(const char *programName)
+{
+    cout << "usage: " << programName << " -batch [-p ParamsFile] [key=value ...]\n";
+    cout << "  processes every file of ImageFolder matching RegexImageFile without opening any window\n";
+    cout << "  keys are the ImageCalculatorParams field names, e.g.\n";
+    cout << "    operationMode=3 ImageFolder=/data/in OutFolder=/data/out roiSize=61 saveStatistics=1\n";
+    cout << "  operationMode: 0 TiffRoiFromRed, 1 ImageResize, 2 ImageLinearOperation,\n";
+    cout << "                 3 CreateROI, 4 CreateMaZdaScript, 5 ViewRoi\n";
+    cout << "  threadCount=N processes N files at once, 0 uses one thread per core\n";
+    cout << "  readThreadCount=N decodes ahead with N threads, queueSize=N limits images waiting between stages\n";
+    cout << "  minImageWidth=N minImageHeight=N imageBitsPerSample=N select TIFF files by their header, 0 means any\n";
+    cout << "  stage timings and throughput are written to OutFolder as BatchReport_<date>_<time>.json\n";
+    cout << "  arguments are applied in order, so key=value after -p overrides the file\n";
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool IsBatchCommandLine(int argc, char *argv[])
+{
+    for(int i = 1; i < argc; i++)
+    {
+        if(string(argv[i]) == "-batch")
+            return 1;
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+int RunBatch(int argc, char *argv[])
+{
+    ImageCalculatorParams Params;
+
+    DisableDisplay(Params);
+    Params.showTiffInfo = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        string Arg = argv[i];
+        if(Arg == "-batch")
+            continue;
+        if(Arg == "-h" || Arg == "-help" || Arg == "--help")
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        if(Arg == "-p")
+        {
+            if(i + 1 >= argc)
+            {
+                cerr << "missing parameter file name after -p\n";
+                return 1;
+            }
+            i++;
+            string Error;
+            if(!LoadParamsFile(Params, argv[i], &Error))
+            {
+                cerr << Error << "\n";
+                return 1;
+            }
+            continue;
+        }
+        size_t separatorPos = Arg.find('=');
+        if(separatorPos == string::npos || !SetParam(Params, Arg.substr(0, separatorPos), Arg.substr(separatorPos + 1)))
+        {
+            cerr << "improper argument " << Arg << "\n";
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(!ProcessAll(Params, cout))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,7 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+bool IsBatchCommandLine(int argc, char *argv[]);
+int RunBatch(int argc, char *argv[]);
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,65 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+//------------------------------------------------------------------------------------------------------------------------------
+// Queue connecting two pipeline stages. Push blocks while the queue is full, so a fast producer
+// cannot hold more than capacity items in memory. Pop returns false once the queue is closed and empty.
+//------------------------------------------------------------------------------------------------------------------------------
+template <class T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1), closed(false)
+    {
+    }
+
+    bool Push(T Item)
+    {
+        std::unique_lock<std::mutex> lock(QueueMutex);
+        NotFull.wait(lock, [this]{ return closed || Items.size() < capacity; });
+        if(closed)
+            return false;
+        Items.push_back(std::move(Item));
+        lock.unlock();
+        NotEmpty.notify_one();
+        return true;
+    }
+
+    bool Pop(T &Item)
+    {
+        std::unique_lock<std::mutex> lock(QueueMutex);
+        NotEmpty.wait(lock, [this]{ return closed || !Items.empty(); });
+        if(Items.empty())
+            return false;
+        Item = std::move(Items.front());
+        Items.pop_front();
+        lock.unlock();
+        NotFull.notify_one();
+        return true;
+    }
+
+    // no more Push, Pop drains what is left
+    void Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(QueueMutex);
+            closed = true;
+        }
+        NotFull.notify_all();
+        NotEmpty.notify_all();
+    }
+
+private:
+    std::mutex QueueMutex;
+    std::condition_variable NotFull;
+    std::condition_variable NotEmpty;
+    std::deque<T> Items;
+    size_t capacity;
+    bool closed;
+};
+
+#endif // BOUNDEDQUEUE_H
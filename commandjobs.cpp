@@ -0,0 +1,231 @@
+#include "commandjobs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+//------------------------------------------------------------------------------------------------------------------------------
+CommandJobResult::CommandJobResult() :
+    succeeded(0),
+    timedOut(0),
+    exitCode(-1),
+    attempts(0),
+    seconds(0.0)
+{
+}
+//------------------------------------------------------------------------------------------------------------------------------
+#ifdef _WIN32
+// the process is started in a job object, so a timeout also kills what cmd started
+int RunCommand(const string &Command, const string &WorkingDirectory, double timeoutSeconds, bool &timedOut)
+{
+    timedOut = 0;
+    string CommandLine = "cmd /c \"" + Command + "\"";
+    vector<char> CommandLineBuffer(CommandLine.begin(), CommandLine.end());
+    CommandLineBuffer.push_back(0);
+
+    HANDLE Job = CreateJobObjectA(0, 0);
+    if(!Job)
+        return -1;
+    STARTUPINFOA StartupInfo;
+    ZeroMemory(&StartupInfo, sizeof(StartupInfo));
+    StartupInfo.cb = sizeof(StartupInfo);
+    PROCESS_INFORMATION ProcessInfo;
+    if(!CreateProcessA(0, CommandLineBuffer.data(), 0, 0, FALSE, CREATE_SUSPENDED | CREATE_NO_WINDOW, 0,
+                       WorkingDirectory.empty() ? 0 : WorkingDirectory.c_str(), &StartupInfo, &ProcessInfo))
+    {
+        CloseHandle(Job);
+        return -1;
+    }
+    AssignProcessToJobObject(Job, ProcessInfo.hProcess);
+    ResumeThread(ProcessInfo.hThread);
+
+    DWORD wait = WaitForSingleObject(ProcessInfo.hProcess, timeoutSeconds > 0.0 ? (DWORD)(timeoutSeconds * 1000.0) : INFINITE);
+    int exitCode = -1;
+    if(wait == WAIT_OBJECT_0)
+    {
+        DWORD processExitCode;
+        if(GetExitCodeProcess(ProcessInfo.hProcess, &processExitCode))
+            exitCode = (int)processExitCode;
+    }
+    else
+    {
+        timedOut = 1;
+        TerminateJobObject(Job, 1);
+        WaitForSingleObject(ProcessInfo.hProcess, INFINITE);
+    }
+    CloseHandle(ProcessInfo.hThread);
+    CloseHandle(ProcessInfo.hProcess);
+    CloseHandle(Job);
+    return exitCode;
+}
+#else
+// the child gets its own process group, so a timeout also kills what the shell started
+int RunCommand(const string &Command, const string &WorkingDirectory, double timeoutSeconds, bool &timedOut)
+{
+    timedOut = 0;
+    const char *CommandText = Command.c_str();
+    const char *Directory = WorkingDirectory.empty() ? 0 : WorkingDirectory.c_str();
+    pid_t pid = fork();
+    if(pid < 0)
+        return -1;
+    if(pid == 0)
+    {
+        setpgid(0, 0);
+        if(Directory && chdir(Directory) != 0)
+            _exit(127);
+        execl("/bin/sh", "sh", "-c", CommandText, (char *)0);
+        _exit(127);
+    }
+    setpgid(pid, pid);
+
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    int pollMilliseconds = 1;
+    int status = 0;
+    while(1)
+    {
+        pid_t done = waitpid(pid, &status, WNOHANG);
+        if(done == pid)
+            break;
+        if(done < 0)
+            return -1;
+        std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - Start;
+        if(timeoutSeconds > 0.0 && Elapsed.count() >= timeoutSeconds)
+        {
+            timedOut = 1;
+            kill(-pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            return -1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(pollMilliseconds));
+        pollMilliseconds = min(pollMilliseconds * 2, 50);
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+#endif
+//------------------------------------------------------------------------------------------------------------------------------
+bool FileExists(const string &FileName)
+{
+    std::ifstream In(FileName);
+    return In.good();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+CommandJobResult RunCommandJob(const CommandJob &Job, double timeoutSeconds, int retries, const string &WorkingDirectory)
+{
+    CommandJobResult Result;
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    for(int attempt = 0; attempt <= max(retries, 0); attempt++)
+    {
+        if(!Job.ShardFile.empty())
+            std::remove(Job.ShardFile.c_str());
+        Result.attempts++;
+        Result.exitCode = RunCommand(Job.Command, WorkingDirectory, timeoutSeconds, Result.timedOut);
+        Result.succeeded = Result.exitCode == 0 && (Job.ShardFile.empty() || FileExists(Job.ShardFile));
+        if(Result.succeeded)
+            break;
+    }
+    std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - Start;
+    Result.seconds = Elapsed.count();
+    return Result;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool RunCommandJobs(const vector<CommandJob> &Jobs, int parallelJobs, double timeoutSeconds, int retries,
+                    const string &WorkingDirectory, vector<CommandJobResult> &Results)
+{
+    int jobsCount = (int)Jobs.size();
+    Results.assign(jobsCount, CommandJobResult());
+
+    int threadCount = parallelJobs;
+    if(threadCount <= 0)
+        threadCount = (int)std::thread::hardware_concurrency();
+    threadCount = min(max(threadCount, 1), max(jobsCount, 1));
+
+    std::atomic<int> nextJobNr(0);
+    auto Runner = [&]()
+    {
+        int jobNr;
+        while((jobNr = nextJobNr++) < jobsCount)
+            Results[jobNr] = RunCommandJob(Jobs[jobNr], timeoutSeconds, retries, WorkingDirectory);
+    };
+    vector<std::thread> Threads;
+    for(int i = 0; i < threadCount; i++)
+        Threads.push_back(std::thread(Runner));
+    for(std::thread &T : Threads)
+        T.join();
+
+    for(const CommandJobResult &Result : Results)
+    {
+        if(!Result.succeeded)
+            return 0;
+    }
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool MergeShards(const vector<string> &ShardFiles, const string &OutFile, bool skipRepeatedHeader)
+{
+    std::ofstream Out(OutFile, std::ios::binary);
+    if(!Out.is_open())
+        return 0;
+
+    bool allShards = 1;
+    bool firstShard = 1;
+    string Header;
+    for(const string &ShardFile : ShardFiles)
+    {
+        std::ifstream In(ShardFile, std::ios::binary);
+        if(!In.is_open())
+        {
+            allShards = 0;
+            continue;
+        }
+        string Line;
+        bool firstLine = 1;
+        while(getline(In, Line))
+        {
+            if(firstLine && skipRepeatedHeader)
+            {
+                if(firstShard)
+                    Header = Line;
+                else if(Line == Header)
+                {
+                    firstLine = 0;
+                    continue;
+                }
+            }
+            firstLine = 0;
+            Out << Line << "\n";
+        }
+        firstShard = 0;
+    }
+    Out.close();
+    return allShards && !Out.fail();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string FailedCommandJobsAsText(const vector<CommandJob> &Jobs, const vector<CommandJobResult> &Results)
+{
+    ostringstream Out;
+    for(size_t i = 0; i < Jobs.size() && i < Results.size(); i++)
+    {
+        const CommandJobResult &Result = Results[i];
+        if(Result.succeeded)
+            continue;
+        Out << "Job failed after " << Result.attempts << " attempts, "
+            << (Result.timedOut ? string("timed out") : "exit code " + to_string(Result.exitCode)) << ": "
+            << Jobs[i].Command << "\n";
+    }
+    return Out.str();
+}
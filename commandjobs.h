@@ -0,0 +1,39 @@
+#ifndef COMMANDJOBS_H
+#define COMMANDJOBS_H
+
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------------------------------------------------------
+// One local command and the output shard it writes. The command is run by /bin/sh -c, or cmd /c on
+// Windows, so any executable or script can stand in for MzGenerator.
+//------------------------------------------------------------------------------------------------------------------------------
+struct CommandJob
+{
+    std::string Command;
+    std::string ShardFile;              // removed before every attempt, the job fails when it is missing after
+};
+//------------------------------------------------------------------------------------------------------------------------------
+struct CommandJobResult
+{
+    bool succeeded;
+    bool timedOut;                      // the last attempt was killed
+    int exitCode;                       // of the last attempt, -1 when it did not start or was killed
+    int attempts;
+    double seconds;                     // of all attempts
+
+    CommandJobResult();
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// Runs the jobs with at most parallelJobs at a time (0 for the number of cores) in WorkingDirectory.
+// A job running longer than timeoutSeconds (0 for no limit) is killed with its child processes;
+// a failed job is started again up to retries times. Returns 1 when every job succeeded.
+bool RunCommandJobs(const std::vector<CommandJob> &Jobs, int parallelJobs, double timeoutSeconds, int retries,
+                    const std::string &WorkingDirectory, std::vector<CommandJobResult> &Results);
+// Concatenates the shards in the given order. With skipRepeatedHeader the first line of a later shard
+// is dropped when it equals the first line of the first shard. Missing shards are skipped and give 0.
+bool MergeShards(const std::vector<std::string> &ShardFiles, const std::string &OutFile, bool skipRepeatedHeader);
+// one line per failed job
+std::string FailedCommandJobsAsText(const std::vector<CommandJob> &Jobs, const std::vector<CommandJobResult> &Results);
+
+#endif // COMMANDJOBS_H
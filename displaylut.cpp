@@ -0,0 +1,117 @@
+#include "displaylut.h"
+
+#include <list>
+#include <mutex>
+#include <cstring>
+
+#include <opencv2/core/core.hpp>
+
+#include "DispLib.h"
+
+using namespace std;
+using namespace cv;
+
+namespace
+{
+//------------------------------------------------------------------------------------------------------------------------------
+struct CachedTable
+{
+    double minDisp;
+    double maxDisp;
+    int valueCount;
+    shared_ptr<const Mat> Table;
+};
+
+const size_t maxCachedTables = 16;
+
+std::mutex TablesMutex;
+list<CachedTable> Tables;  // most recently used first
+}
+//------------------------------------------------------------------------------------------------------------------------------
+shared_ptr<const Mat> GetPseudoColorTable(double minDisp, double maxDisp, int valueCount)
+{
+    {
+        std::lock_guard<std::mutex> lock(TablesMutex);
+        for(auto Cached = Tables.begin(); Cached != Tables.end(); ++Cached)
+        {
+            if(Cached->minDisp == minDisp && Cached->maxDisp == maxDisp && Cached->valueCount == valueCount)
+            {
+                Tables.splice(Tables.begin(), Tables, Cached);
+                return Tables.front().Table;
+            }
+        }
+    }
+
+    Mat Ramp(1, valueCount, CV_64F);
+    double *wRamp = Ramp.ptr<double>(0);
+    for(int i = 0; i < valueCount; i++)
+        wRamp[i] = (double)i;
+    shared_ptr<Mat> Table = make_shared<Mat>(ShowImageF64PseudoColor(Ramp, minDisp, maxDisp));
+
+    CachedTable NewTable;
+    NewTable.minDisp = minDisp;
+    NewTable.maxDisp = maxDisp;
+    NewTable.valueCount = valueCount;
+    NewTable.Table = Table;
+
+    std::lock_guard<std::mutex> lock(TablesMutex);
+    Tables.push_front(NewTable);
+    if(Tables.size() > maxCachedTables)
+        Tables.pop_back();
+    return Table;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+template<class T, class Colour>
+void ApplyTableRows(const Mat &Im, const Mat &Table, Mat &ImOut)
+{
+    const Colour *wTable = Table.ptr<Colour>(0);
+    parallel_for_(Range(0, Im.rows), [&](const Range &Rows)
+    {
+        for(int y = Rows.start; y < Rows.end; y++)
+        {
+            const T *wIm = Im.ptr<T>(y);
+            Colour *wImOut = ImOut.ptr<Colour>(y);
+            for(int x = 0; x < Im.cols; x++)
+                wImOut[x] = wTable[wIm[x]];
+        }
+    });
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// any table type, one memcpy per pixel
+template<class T>
+void ApplyTableRowsBytes(const Mat &Im, const Mat &Table, Mat &ImOut)
+{
+    size_t colourSize = Table.elemSize();
+    const uchar *wTable = Table.ptr<uchar>(0);
+    parallel_for_(Range(0, Im.rows), [&](const Range &Rows)
+    {
+        for(int y = Rows.start; y < Rows.end; y++)
+        {
+            const T *wIm = Im.ptr<T>(y);
+            uchar *wImOut = ImOut.ptr<uchar>(y);
+            for(int x = 0; x < Im.cols; x++)
+                memcpy(wImOut + x * colourSize, wTable + wIm[x] * colourSize, colourSize);
+        }
+    });
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Mat ApplyDisplayTable(Mat Im, const Mat &Table)
+{
+    Mat ImOut(Im.size(), Table.type());
+    bool colour = Table.type() == CV_8UC3;
+    if(Im.depth() == CV_8U)
+    {
+        if(colour)
+            ApplyTableRows<uchar, Vec3b>(Im, Table, ImOut);
+        else
+            ApplyTableRowsBytes<uchar>(Im, Table, ImOut);
+    }
+    else
+    {
+        if(colour)
+            ApplyTableRows<ushort, Vec3b>(Im, Table, ImOut);
+        else
+            ApplyTableRowsBytes<ushort>(Im, Table, ImOut);
+    }
+    return ImOut;
+}
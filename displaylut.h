@@ -0,0 +1,18 @@
+#ifndef DISPLAYLUT_H
+#define DISPLAYLUT_H
+
+#include <memory>
+
+#include <opencv2/core/core.hpp>
+
+//------------------------------------------------------------------------------------------------------------------------------
+// Pseudo colour of every possible 8 or 16 bit input value for one display range, a 1 x valueCount
+// image made by ShowImageF64PseudoColor from a ramp of all values, so the colours are the same as
+// the per pixel rendering. The last tables are cached. Thread safe.
+//------------------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<const cv::Mat> GetPseudoColorTable(double minDisp, double maxDisp, int valueCount);
+
+// 8U or 16U single channel image through a table from GetPseudoColorTable, rows in parallel
+cv::Mat ApplyDisplayTable(cv::Mat Im, const cv::Mat &Table);
+
+#endif // DISPLAYLUT_H
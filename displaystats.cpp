@@ -0,0 +1,231 @@
+#include "displaystats.h"
+
+#include <list>
+#include <mutex>
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+using namespace cv;
+
+namespace
+{
+//------------------------------------------------------------------------------------------------------------------------------
+struct CachedStatistics
+{
+    string ImageKey;
+    shared_ptr<const DisplayStatistics> Stats;
+};
+
+const size_t maxCachedStatistics = 4;
+
+std::mutex StatisticsMutex;
+list<CachedStatistics> Statistics;  // most recently used first
+}
+//------------------------------------------------------------------------------------------------------------------------------
+DisplayStatistics::DisplayStatistics() :
+    count(0),
+    sum(0.0),
+    sumOfSquares(0.0),
+    minValue(0.0),
+    maxValue(0.0),
+    binStart(0.0),
+    binWidth(1.0)
+{
+}
+//------------------------------------------------------------------------------------------------------------------------------
+double DisplayStatistics::Mean() const
+{
+    if(!count)
+        return 0.0;
+    return sum / (double)count;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+double DisplayStatistics::Std() const
+{
+    if(!count)
+        return 0.0;
+    double mean = Mean();
+    double variance = sumOfSquares / (double)count - mean * mean;
+    if(variance < 0.0)
+        variance = 0.0;
+    return sqrt(variance);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// lowest value with at least fraction * count pixels at or below it
+double DisplayStatistics::Percentile(double fraction) const
+{
+    if(!count)
+        return 0.0;
+    double limit = fraction * (double)count;
+    uint64_t cumulated = 0;
+    for(size_t bin = 0; bin < Histogram.size(); bin++)
+    {
+        cumulated += Histogram[bin];
+        if(cumulated && (double)cumulated >= limit)
+            return min(max(binStart + (double)bin * binWidth, minValue), maxValue);
+    }
+    return maxValue;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+template<class T>
+void AccumulateRows(const Mat &Im, const Mat &Mask, int roiNr, int firstRow, int lastRow, DisplayStatistics &Stats)
+{
+    double minValue = Stats.minValue;
+    double maxValue = Stats.maxValue;
+    double binStart = Stats.binStart;
+    double binScale = 1.0 / Stats.binWidth;
+    int lastBin = (int)Stats.Histogram.size() - 1;
+    uint64_t *wHistogram = Stats.Histogram.data();
+    for(int y = firstRow; y < lastRow; y++)
+    {
+        const T *wIm = Im.ptr<T>(y);
+        const uint16_t *wMask = Mask.empty() ? 0 : Mask.ptr<uint16_t>(y);
+        for(int x = 0; x < Im.cols; x++)
+        {
+            if(wMask && (int)wMask[x] != roiNr)
+                continue;
+            double value = (double)wIm[x];
+            if(value != value)
+                continue;
+            Stats.count++;
+            Stats.sum += value;
+            Stats.sumOfSquares += value * value;
+            if(minValue > value)
+                minValue = value;
+            if(maxValue < value)
+                maxValue = value;
+            int bin = (int)((value - binStart) * binScale);
+            wHistogram[min(max(bin, 0), lastBin)]++;
+        }
+    }
+    Stats.minValue = minValue;
+    Stats.maxValue = maxValue;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool ComputeDisplayStatistics(Mat Im, Mat Mask, int roiNr, DisplayStatistics &Stats)
+{
+    Stats = DisplayStatistics();
+    if(Im.empty() || Im.channels() != 1)
+        return 0;
+    if(!Mask.empty() && (Mask.type() != CV_16U || Mask.size() != Im.size()))
+        return 0;
+
+    int depth = Im.depth();
+    switch(depth)
+    {
+    case CV_8U:
+        Stats.Histogram.resize(256);
+        break;
+    case CV_16U:
+        Stats.Histogram.resize(65536);
+        break;
+    case CV_16S:
+        Stats.binStart = -32768.0;
+        Stats.Histogram.resize(65536);
+        break;
+    default:
+    {
+        // the bins of wider types need the range first
+        double minValue, maxValue;
+        if(Mask.empty())
+            minMaxLoc(Im, &minValue, &maxValue);
+        else
+            minMaxLoc(Im, &minValue, &maxValue, 0, 0, Mask == roiNr);
+        Stats.binStart = minValue;
+        Stats.binWidth = maxValue > minValue ? (maxValue - minValue) / 65536.0 : 1.0;
+        Stats.Histogram.resize(65536);
+        break;
+    }
+    }
+    Stats.minValue = HUGE_VAL;
+    Stats.maxValue = -HUGE_VAL;
+
+    int stripesCount = min(max(getNumThreads(), 1), Im.rows);
+    vector<DisplayStatistics> Stripes(stripesCount, Stats);
+    parallel_for_(Range(0, stripesCount), [&](const Range &StripeRange)
+    {
+        for(int stripe = StripeRange.start; stripe < StripeRange.end; stripe++)
+        {
+            int firstRow = (int)((int64_t)Im.rows * stripe / stripesCount);
+            int lastRow = (int)((int64_t)Im.rows * (stripe + 1) / stripesCount);
+            DisplayStatistics &Stripe = Stripes[stripe];
+            switch(depth)
+            {
+            case CV_8U:
+                AccumulateRows<uint8_t>(Im, Mask, roiNr, firstRow, lastRow, Stripe);
+                break;
+            case CV_16U:
+                AccumulateRows<uint16_t>(Im, Mask, roiNr, firstRow, lastRow, Stripe);
+                break;
+            case CV_16S:
+                AccumulateRows<int16_t>(Im, Mask, roiNr, firstRow, lastRow, Stripe);
+                break;
+            case CV_32S:
+                AccumulateRows<int32_t>(Im, Mask, roiNr, firstRow, lastRow, Stripe);
+                break;
+            case CV_32F:
+                AccumulateRows<float>(Im, Mask, roiNr, firstRow, lastRow, Stripe);
+                break;
+            default:
+                AccumulateRows<double>(Im, Mask, roiNr, firstRow, lastRow, Stripe);
+                break;
+            }
+        }
+    });
+
+    for(DisplayStatistics &Stripe : Stripes)
+    {
+        Stats.count += Stripe.count;
+        Stats.sum += Stripe.sum;
+        Stats.sumOfSquares += Stripe.sumOfSquares;
+        Stats.minValue = min(Stats.minValue, Stripe.minValue);
+        Stats.maxValue = max(Stats.maxValue, Stripe.maxValue);
+        for(size_t bin = 0; bin < Stats.Histogram.size(); bin++)
+            Stats.Histogram[bin] += Stripe.Histogram[bin];
+    }
+    if(!Stats.count)
+    {
+        Stats.minValue = 0.0;
+        Stats.maxValue = 0.0;
+    }
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+shared_ptr<const DisplayStatistics> GetDisplayStatistics(const string &ImageKey, Mat Im)
+{
+    if(!ImageKey.empty())
+    {
+        std::lock_guard<std::mutex> lock(StatisticsMutex);
+        for(auto Cached = Statistics.begin(); Cached != Statistics.end(); ++Cached)
+        {
+            if(Cached->ImageKey == ImageKey)
+            {
+                Statistics.splice(Statistics.begin(), Statistics, Cached);
+                return Statistics.front().Stats;
+            }
+        }
+    }
+
+    shared_ptr<const DisplayStatistics> Stats = GetDisplayStatistics(Im, Mat(), 0);
+    if(!Stats || ImageKey.empty())
+        return Stats;
+
+    CachedStatistics NewStatistics;
+    NewStatistics.ImageKey = ImageKey;
+    NewStatistics.Stats = Stats;
+
+    std::lock_guard<std::mutex> lock(StatisticsMutex);
+    Statistics.push_front(NewStatistics);
+    if(Statistics.size() > maxCachedStatistics)
+        Statistics.pop_back();
+    return Stats;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+shared_ptr<const DisplayStatistics> GetDisplayStatistics(Mat Im, Mat Mask, int roiNr)
+{
+    shared_ptr<DisplayStatistics> Stats = make_shared<DisplayStatistics>();
+    if(!ComputeDisplayStatistics(Im, Mask, roiNr, *Stats))
+        return shared_ptr<const DisplayStatistics>();
+    return Stats;
+}
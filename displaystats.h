@@ -0,0 +1,44 @@
+#ifndef DISPLAYSTATS_H
+#define DISPLAYSTATS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <opencv2/core/core.hpp>
+
+//------------------------------------------------------------------------------------------------------------------------------
+// Histogram and moments of an image, or of the pixels of one ROI of a 16U label mask. All display
+// ranges (min max, mean +- 3 std, 1 - 99 percentile) are derived from it without another image pass.
+// 8U, 16U and 16S are binned per value; 32S and floating point images get 65536 bins between
+// min and max, so their percentiles are exact to one bin.
+//------------------------------------------------------------------------------------------------------------------------------
+struct DisplayStatistics
+{
+    uint64_t count;
+    double sum;
+    double sumOfSquares;
+    double minValue;
+    double maxValue;
+
+    double binStart;                // bin i holds values from binStart + i * binWidth
+    double binWidth;
+    std::vector<uint64_t> Histogram;
+
+    DisplayStatistics();
+    double Mean() const;
+    double Std() const;
+    double Percentile(double fraction) const;
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// single channel images only, Mask empty for the whole image; rows in parallel
+bool ComputeDisplayStatistics(cv::Mat Im, cv::Mat Mask, int roiNr, DisplayStatistics &Stats);
+
+// ComputeDisplayStatistics through a small cache of statistics only, no image is kept. ImageKey names
+// the content of Im, e.g. file, modification time and load flags of an input image; an empty key
+// computes without caching. Thread safe. Returns 0 for unsupported images.
+std::shared_ptr<const DisplayStatistics> GetDisplayStatistics(const std::string &ImageKey, cv::Mat Im);
+std::shared_ptr<const DisplayStatistics> GetDisplayStatistics(cv::Mat Im, cv::Mat Mask, int roiNr);
+
+#endif // DISPLAYSTATS_H
@@ -0,0 +1,396 @@
+#include "filecatalog.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+
+#include <boost/regex.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <tiffio.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace boost;
+using namespace std;
+using namespace boost::filesystem;
+
+//------------------------------------------------------------------------------------------------------------------------------
+CatalogEntry::CatalogEntry()
+{
+    size = 0;
+    modificationTime = 0;
+    width = 0;
+    height = 0;
+    bitsPerSample = 0;
+    channels = 0;
+    xRes = 1.0;
+    yRes = 1.0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+CatalogFilter::CatalogFilter()
+{
+    RegexImageFile = ".+";
+    minWidth = 0;
+    minHeight = 0;
+    bitsPerSample = 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+FileCatalog::FileCatalog()
+{
+    dirty = 0;
+    notifyHandle = -1;
+    watchHandle = -1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+FileCatalog::~FileCatalog()
+{
+    Close();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// loads the stored catalog and brings it up to date with the folder
+bool FileCatalog::Open(path Folder)
+{
+    Close();
+    if (!exists(Folder) || !is_directory(Folder))
+        return 0;
+    CatalogFolder = Folder;
+    Load();
+    Refresh();
+    Save();
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void FileCatalog::Close()
+{
+    if(dirty)
+        Save();
+#ifdef __linux__
+    if(notifyHandle >= 0)
+        close(notifyHandle);
+#endif
+    notifyHandle = -1;
+    watchHandle = -1;
+    Entries.clear();
+    CatalogFolder.clear();
+    dirty = 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+path FileCatalog::Folder() const
+{
+    return CatalogFolder;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// one pass over the folder, headers are read only for new or modified files
+int FileCatalog::Refresh()
+{
+    if(CatalogFolder.empty())
+        return 0;
+
+    int changesCount = 0;
+    map<string, CatalogEntry> Found;
+    boost::system::error_code ec;
+    for (directory_entry& FileToProcess : directory_iterator(CatalogFolder, ec))
+    {
+        string FileName = FileToProcess.path().filename().string();
+        if(!is_regular_file(FileToProcess.status()))
+            continue;
+
+        CatalogEntry Entry;
+        Entry.FileName = FileName;
+        Entry.size = file_size(FileToProcess.path(), ec);
+        Entry.modificationTime = last_write_time(FileToProcess.path(), ec);
+
+        auto Known = Entries.find(FileName);
+        if(Known != Entries.end() && Known->second.size == Entry.size && Known->second.modificationTime == Entry.modificationTime)
+        {
+            Found[FileName] = Known->second;
+            continue;
+        }
+        ReadImageProperties(FileToProcess.path(), Entry);
+        Found[FileName] = Entry;
+        changesCount++;
+    }
+    for(auto &Item : Entries)
+    {
+        if(Found.find(Item.first) == Found.end())
+            changesCount++;
+    }
+    Entries.swap(Found);
+    if(changesCount)
+        dirty = 1;
+    return changesCount;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// LOCALAPPDATA on Windows, XDG_CACHE_HOME or ~/.cache elsewhere, the temporary folder when none is set
+path FileCatalog::CacheFolder()
+{
+#ifdef _WIN32
+    const char *Base = getenv("LOCALAPPDATA");
+    if(Base && *Base)
+        return path(Base) / "ImageCalculator" / "Catalogs";
+#else
+    const char *Base = getenv("XDG_CACHE_HOME");
+    if(Base && *Base)
+        return path(Base) / "ImageCalculator" / "catalogs";
+    const char *Home = getenv("HOME");
+    if(Home && *Home)
+        return path(Home) / ".cache" / "ImageCalculator" / "catalogs";
+#endif
+    boost::system::error_code ec;
+    return temp_directory_path(ec) / "ImageCalculatorCatalogs";
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// the same for every spelling of the folder path
+string FileCatalog::FolderKey() const
+{
+    boost::system::error_code ec;
+    path Canonical = canonical(CatalogFolder, ec);
+    if(ec)
+        return absolute(CatalogFolder).string();
+    return Canonical.string();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// named by a hash of the folder key, the key itself is the second line of the file
+path FileCatalog::CatalogFile() const
+{
+    string FolderName = FolderKey();
+    uint64_t hash = 14695981039346656037ULL;
+    for(unsigned char c : FolderName)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    ostringstream Name;
+    Name << "Catalog_" << hex << setfill('0') << setw(16) << hash << ".txt";
+    return CacheFolder() / Name.str();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool FileCatalog::Load()
+{
+    std::ifstream In(CatalogFile().string());
+    if(!In.is_open())
+        return 0;
+
+    string Line;
+    if(!getline(In, Line) || Line != "ImageCalculatorCatalog 2")
+        return 0;
+    if(!getline(In, Line) || Line != FolderKey())
+        return 0;
+
+    while(getline(In, Line))
+    {
+        // the file name goes last, it may contain spaces
+        istringstream LineStream(Line);
+        CatalogEntry Entry;
+        long long modificationTime;
+        LineStream >> Entry.size >> modificationTime >> Entry.width >> Entry.height
+                   >> Entry.bitsPerSample >> Entry.channels >> Entry.xRes >> Entry.yRes;
+        LineStream.get();
+        getline(LineStream, Entry.FileName);
+        if(LineStream.fail() || Entry.FileName.empty())
+            continue;
+        Entry.modificationTime = (std::time_t)modificationTime;
+        Entries[Entry.FileName] = Entry;
+    }
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// the cache may be unwritable, the catalog is then rebuilt on every open
+bool FileCatalog::Save()
+{
+    if(CatalogFolder.empty())
+        return 0;
+
+    boost::system::error_code ec;
+    path StoredFile = CatalogFile();
+    create_directories(StoredFile.parent_path(), ec);
+    // unique per process, two programs may save the catalog of the same folder at once
+    path TempFile = StoredFile;
+    TempFile += unique_path(".%%%%%%%%.tmp");
+
+    std::ofstream Out(TempFile.string());
+    if(!Out.is_open())
+        return 0;
+    Out << "ImageCalculatorCatalog 2\n";
+    Out << FolderKey() << "\n";
+    for(auto &Item : Entries)
+    {
+        const CatalogEntry &Entry = Item.second;
+        Out << Entry.size << " " << (long long)Entry.modificationTime << " " << Entry.width << " " << Entry.height << " "
+            << Entry.bitsPerSample << " " << Entry.channels << " " << Entry.xRes << " " << Entry.yRes << " "
+            << Entry.FileName << "\n";
+    }
+    Out.close();
+    if(Out.fail())
+    {
+        remove(TempFile, ec);
+        return 0;
+    }
+
+    rename(TempFile, StoredFile, ec);
+    if(ec)
+    {
+        remove(TempFile, ec);
+        return 0;
+    }
+    dirty = 0;
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// returns 1 when the entry was added, changed or removed
+bool FileCatalog::UpdateEntry(const path &FilePath)
+{
+    string FileName = FilePath.filename().string();
+    boost::system::error_code ec;
+    if(!is_regular_file(FilePath, ec))
+        return Entries.erase(FileName) > 0;
+
+    CatalogEntry Entry;
+    Entry.FileName = FileName;
+    Entry.size = file_size(FilePath, ec);
+    Entry.modificationTime = last_write_time(FilePath, ec);
+
+    auto Known = Entries.find(FileName);
+    if(Known != Entries.end() && Known->second.size == Entry.size && Known->second.modificationTime == Entry.modificationTime)
+        return 0;
+
+    ReadImageProperties(FilePath, Entry);
+    Entries[FileName] = Entry;
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void FileCatalog::ReadImageProperties(const path &FilePath, CatalogEntry &Entry)
+{
+    string extension = algorithm::to_lower_copy(FilePath.extension().string());
+    if(extension != ".tif" && extension != ".tiff")
+        return;
+
+    TIFF *tifIm = TIFFOpen(FilePath.string().c_str(),"r");
+    if(!tifIm)
+        return;
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint16_t bitsPerSample = 0;
+    uint16_t samplesPerPixel = 1;
+    TIFFGetField(tifIm, TIFFTAG_IMAGEWIDTH, &width);
+    TIFFGetField(tifIm, TIFFTAG_IMAGELENGTH, &height);
+    TIFFGetField(tifIm, TIFFTAG_BITSPERSAMPLE, &bitsPerSample);
+    TIFFGetFieldDefaulted(tifIm, TIFFTAG_SAMPLESPERPIXEL, &samplesPerPixel);
+    TIFFGetField(tifIm, TIFFTAG_XRESOLUTION, &Entry.xRes);
+    TIFFGetField(tifIm, TIFFTAG_YRESOLUTION, &Entry.yRes);
+    TIFFClose(tifIm);
+
+    Entry.width = (int)width;
+    Entry.height = (int)height;
+    Entry.bitsPerSample = bitsPerSample;
+    Entry.channels = samplesPerPixel;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool FileCatalog::StartWatching()
+{
+#ifdef __linux__
+    if(CatalogFolder.empty())
+        return 0;
+    if(notifyHandle >= 0)
+        return 1;
+    notifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(notifyHandle < 0)
+        return 0;
+    watchHandle = inotify_add_watch(notifyHandle, CatalogFolder.string().c_str(),
+                                    IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB);
+    if(watchHandle < 0)
+    {
+        close(notifyHandle);
+        notifyHandle = -1;
+        return 0;
+    }
+    return 1;
+#else
+    return 0;
+#endif
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// readable when ProcessChanges has work to do, -1 when the folder is not watched
+int FileCatalog::ChangeNotificationHandle() const
+{
+    return notifyHandle;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// applies the pending inotify events, returns the number of changed entries
+int FileCatalog::ProcessChanges()
+{
+    int changesCount = 0;
+#ifdef __linux__
+    if(notifyHandle < 0)
+        return 0;
+
+    char Buffer[16384] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    bool overflow = 0;
+    while(1)
+    {
+        ssize_t length = read(notifyHandle, Buffer, sizeof(Buffer));
+        if(length <= 0)
+            break;
+        for(char *event = Buffer; event < Buffer + length; )
+        {
+            struct inotify_event *Event = (struct inotify_event *)event;
+            if(Event->mask & IN_Q_OVERFLOW)
+                overflow = 1;
+            else if(Event->len > 0)
+            {
+                path FilePath = CatalogFolder;
+                FilePath.append(string(Event->name));
+                if(UpdateEntry(FilePath))
+                    changesCount++;
+            }
+            event += sizeof(struct inotify_event) + Event->len;
+        }
+    }
+    if(overflow)
+        changesCount += Refresh();
+    if(changesCount)
+        dirty = 1;
+#endif
+    return changesCount;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+vector<string> FileCatalog::Filter(const CatalogFilter &Filter) const
+{
+    vector<string> FileList;
+    regex FilePattern(Filter.RegexImageFile);
+    for(auto &Item : Entries)
+    {
+        const CatalogEntry &Entry = Item.second;
+        // unknown properties (0) pass, a file is not dropped only because its header could not be read
+        if(Filter.minWidth > 0 && Entry.width > 0 && Entry.width < Filter.minWidth)
+            continue;
+        if(Filter.minHeight > 0 && Entry.height > 0 && Entry.height < Filter.minHeight)
+            continue;
+        if(Filter.bitsPerSample > 0 && Entry.bitsPerSample > 0 && Entry.bitsPerSample != Filter.bitsPerSample)
+            continue;
+        if (!regex_match(Entry.FileName, FilePattern))
+            continue;
+        FileList.push_back(Entry.FileName);
+    }
+    return FileList;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool FileCatalog::Find(const string &FileName, CatalogEntry &Entry) const
+{
+    auto Known = Entries.find(FileName);
+    if(Known == Entries.end())
+        return 0;
+    Entry = Known->second;
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+size_t FileCatalog::Count() const
+{
+    return Entries.size();
+}
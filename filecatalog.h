@@ -0,0 +1,86 @@
+#ifndef FILECATALOG_H
+#define FILECATALOG_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ctime>
+#include <cstdint>
+
+#include <boost/filesystem.hpp>
+
+//------------------------------------------------------------------------------------------------------------------------------
+// What the catalog knows about one file of the folder. Image properties come from the TIFF header,
+// for other formats they stay 0 (unknown) because reading them would mean decoding the file.
+//------------------------------------------------------------------------------------------------------------------------------
+struct CatalogEntry
+{
+    std::string FileName;
+    uintmax_t size;
+    std::time_t modificationTime;
+
+    int width;
+    int height;
+    int bitsPerSample;
+    int channels;
+    float xRes;
+    float yRes;
+
+    CatalogEntry();
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// 0 (or empty) means "any". Files whose property is unknown, not TIFF or an unreadable header, pass.
+struct CatalogFilter
+{
+    std::string RegexImageFile;
+    int minWidth;
+    int minHeight;
+    int bitsPerSample;
+
+    CatalogFilter();
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// Per folder index of file name, size, modification time and image properties. Kept in the per user
+// cache folder under a name derived from the folder path, so opening a folder again only re-reads
+// headers of files that changed and the image folder itself is never written. While the folder is
+// open, changes are picked up from inotify (Linux) instead of rescanning it.
+//------------------------------------------------------------------------------------------------------------------------------
+class FileCatalog
+{
+public:
+    static boost::filesystem::path CacheFolder();
+
+    FileCatalog();
+    ~FileCatalog();
+
+    bool Open(boost::filesystem::path Folder);
+    void Close();
+    boost::filesystem::path Folder() const;
+
+    int Refresh();
+    bool Save();
+
+    bool StartWatching();
+    int ChangeNotificationHandle() const;
+    int ProcessChanges();
+
+    std::vector<std::string> Filter(const CatalogFilter &Filter) const;
+    bool Find(const std::string &FileName, CatalogEntry &Entry) const;
+    size_t Count() const;
+
+private:
+    std::string FolderKey() const;
+    boost::filesystem::path CatalogFile() const;
+    bool Load();
+    bool UpdateEntry(const boost::filesystem::path &FilePath);
+    static void ReadImageProperties(const boost::filesystem::path &FilePath, CatalogEntry &Entry);
+
+    boost::filesystem::path CatalogFolder;
+    std::map<std::string, CatalogEntry> Entries;
+    bool dirty;
+
+    int notifyHandle;
+    int watchHandle;
+};
+
+#endif // FILECATALOG_H
@@ -0,0 +1,160 @@
+#include "firstorder.h"
+
+#include <algorithm>
+#include <sstream>
+#include <math.h>
+
+using namespace std;
+using namespace cv;
+
+//------------------------------------------------------------------------------------------------------------------------------
+FirstOrderFeatures::FirstOrderFeatures() :
+    area(0),
+    mean(0.0),
+    variance(0.0),
+    skewness(0.0),
+    kurtosis(0.0),
+    perc01(0.0),
+    perc10(0.0),
+    perc50(0.0),
+    perc90(0.0),
+    perc99(0.0)
+{
+}
+//------------------------------------------------------------------------------------------------------------------------------
+template<class T>
+void GatherRoiValues(const RoiIndex &Index, const Mat &Im, int roiNr, vector<double> &Values)
+{
+    Index.ForEachSpan(roiNr, [&](const RoiSpan &Span)
+    {
+        const T *wIm = Im.ptr<T>(Span.y);
+        for(int x = Span.xStart; x < Span.xEnd; x++)
+            Values.push_back((double)wIm[x]);
+    });
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void GatherRoiValues(const RoiIndex &Index, const Mat &Im, int roiNr, vector<double> &Values)
+{
+    switch(Im.depth())
+    {
+    case CV_8U:
+        GatherRoiValues<uint8_t>(Index, Im, roiNr, Values);
+        break;
+    case CV_16U:
+        GatherRoiValues<uint16_t>(Index, Im, roiNr, Values);
+        break;
+    case CV_16S:
+        GatherRoiValues<int16_t>(Index, Im, roiNr, Values);
+        break;
+    case CV_32S:
+        GatherRoiValues<int32_t>(Index, Im, roiNr, Values);
+        break;
+    case CV_32F:
+        GatherRoiValues<float>(Index, Im, roiNr, Values);
+        break;
+    default:
+        GatherRoiValues<double>(Index, Im, roiNr, Values);
+        break;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// Values sorted ascending
+double SortedPercentile(const vector<double> &Values, double fraction)
+{
+    int64_t position = (int64_t)ceil(fraction * (double)Values.size()) - 1;
+    position = min(max(position, (int64_t)0), (int64_t)Values.size() - 1);
+    return Values[position];
+}
+//------------------------------------------------------------------------------------------------------------------------------
+FirstOrderFeatures FeaturesFromValues(vector<double> &Values)
+{
+    FirstOrderFeatures Features;
+    if(Values.empty())
+        return Features;
+    Features.area = Values.size();
+    double count = (double)Values.size();
+
+    double sum = 0.0;
+    for(double value : Values)
+        sum += value;
+    Features.mean = sum / count;
+
+    double m2 = 0.0;
+    double m3 = 0.0;
+    double m4 = 0.0;
+    for(double value : Values)
+    {
+        double difference = value - Features.mean;
+        double difference2 = difference * difference;
+        m2 += difference2;
+        m3 += difference2 * difference;
+        m4 += difference2 * difference2;
+    }
+    m2 /= count;
+    m3 /= count;
+    m4 /= count;
+    Features.variance = m2;
+    if(m2 > 0.0)
+    {
+        Features.skewness = m3 / (m2 * sqrt(m2));
+        Features.kurtosis = m4 / (m2 * m2) - 3.0;
+    }
+
+    sort(Values.begin(), Values.end());
+    Features.perc01 = SortedPercentile(Values, 0.01);
+    Features.perc10 = SortedPercentile(Values, 0.10);
+    Features.perc50 = SortedPercentile(Values, 0.50);
+    Features.perc90 = SortedPercentile(Values, 0.90);
+    Features.perc99 = SortedPercentile(Values, 0.99);
+    return Features;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool ComputeFirstOrderFeatures(const RoiIndex &Index, Mat Im, vector<FirstOrderFeatures> &Features)
+{
+    Features.clear();
+    if(Im.empty() || Im.channels() != 1 || Im.size() != Index.MaskSize())
+        return 0;
+
+    int maxRoiNr = Index.MaxRoiNr();
+    Features.resize(maxRoiNr);
+    parallel_for_(Range(1, maxRoiNr + 1), [&](const Range &Rois)
+    {
+        vector<double> Values;
+        for(int roiNr = Rois.start; roiNr < Rois.end; roiNr++)
+        {
+            if(!Index.Contains(roiNr))
+                continue;
+            Values.clear();
+            Values.reserve(Index.Area(roiNr));
+            GatherRoiValues(Index, Im, roiNr, Values);
+            Features[roiNr - 1] = FeaturesFromValues(Values);
+        }
+    });
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string FirstOrderFeaturesHeader()
+{
+    return "Category,FileName,HistArea,HistMean,HistVariance,HistSkewness,HistKurtosis,"
+           "HistPerc01,HistPerc10,HistPerc50,HistPerc90,HistPerc99\n";
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string FirstOrderFeaturesAsText(const string &FileName, const vector<string> &RoiNames, const vector<FirstOrderFeatures> &Features)
+{
+    ostringstream Out;
+    Out.precision(10);
+    for(size_t i = 0; i < Features.size(); i++)
+    {
+        const FirstOrderFeatures &Roi = Features[i];
+        if(!Roi.area)
+            continue;
+        if(i < RoiNames.size() && !RoiNames[i].empty())
+            Out << RoiNames[i];
+        else
+            Out << "ROI" << i + 1;
+        Out << "," << FileName << "," << Roi.area << "," << Roi.mean << "," << Roi.variance << ","
+            << Roi.skewness << "," << Roi.kurtosis << "," << Roi.perc01 << "," << Roi.perc10 << ","
+            << Roi.perc50 << "," << Roi.perc90 << "," << Roi.perc99 << "\n";
+    }
+    return Out.str();
+}
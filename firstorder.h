@@ -0,0 +1,42 @@
+#ifndef FIRSTORDER_H
+#define FIRSTORDER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <opencv2/core/core.hpp>
+
+#include "roiindex.h"
+
+//------------------------------------------------------------------------------------------------------------------------------
+// First order (histogram) features of one ROI, computed on the raw pixel values.
+// Percentiles are exact: the lowest value with at least the given share of the ROI at or below it.
+//------------------------------------------------------------------------------------------------------------------------------
+struct FirstOrderFeatures
+{
+    uint64_t area;
+    double mean;
+    double variance;
+    double skewness;
+    double kurtosis;                    // excess kurtosis, 0 for a normal distribution
+    double perc01;
+    double perc10;
+    double perc50;
+    double perc90;
+    double perc99;
+
+    FirstOrderFeatures();
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// Features of every ROI of the index, ROIs in parallel, Features[roiNr - 1] for ROI roiNr.
+// Im is a single channel image of the mask size. ROIs the index does not contain get area 0.
+bool ComputeFirstOrderFeatures(const RoiIndex &Index, cv::Mat Im, std::vector<FirstOrderFeatures> &Features);
+
+// comma separated, one line per ROI in the layout of the MaZda -o .cvs output: the Category column
+// holds the ROI name, followed by the image file name and the features
+std::string FirstOrderFeaturesHeader();
+std::string FirstOrderFeaturesAsText(const std::string &FileName, const std::vector<std::string> &RoiNames,
+                                     const std::vector<FirstOrderFeatures> &Features);
+
+#endif // FIRSTORDER_H
@@ -0,0 +1,217 @@
+// Check of the analytic ROI grid, no Qt needed. For every combination of shape, size, offset, shift,
+// reducedRoi, its complement and skipCount the run length mask of RoiGrid must equal the mask CreateROI
+// used to paint with cv::rectangle and cv::circle, and the tile by tile ROI statistics must equal
+// those of the painted mask for several tile sizes. Returns 0 when every check passes.
+// usage: GridCheck
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "roigrid.h"
+#include "labelstats.h"
+
+using namespace std;
+using namespace cv;
+
+//------------------------------------------------------------------------------------------------------------------------------
+struct GridParams
+{
+    Size ImSize;
+    int roiShape;
+    int roiSize;
+    int roiOffset;
+    int roiShift;
+    bool reducedRoi;
+    bool reducedRoiComplement;
+    int skipCount;
+};
+//------------------------------------------------------------------------------------------------------------------------------
+string GridParamsText(const GridParams &Params)
+{
+    return to_string(Params.ImSize.width) + "x" + to_string(Params.ImSize.height) +
+           " shape " + to_string(Params.roiShape) + " size " + to_string(Params.roiSize) +
+           " offset " + to_string(Params.roiOffset) + " shift " + to_string(Params.roiShift) +
+           " reduced " + to_string(Params.reducedRoi) + " complement " + to_string(Params.reducedRoiComplement) +
+           " skip " + to_string(Params.skipCount);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+RoiGrid MakeGrid(const GridParams &Params)
+{
+    return RoiGrid(Params.ImSize, Params.roiShape, Params.roiSize, Params.roiOffset, Params.roiShift,
+                   Params.reducedRoi, Params.reducedRoiComplement, Params.skipCount);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// the painting loop of CreateROI before the grid, into a 32S mask so that no ROI number saturates
+Mat PaintedGrid(const GridParams &Params)
+{
+    Mat Mask = Mat::zeros(Params.ImSize, CV_32S);
+    int roiSize = Params.roiSize;
+    int lastRoiY = Params.ImSize.height - roiSize / 2;
+    int lastRoiX = Params.ImSize.width - roiSize / 2;
+
+    int roiNr = 1;
+    int skip = 0;
+    for (int y = Params.roiOffset; y < lastRoiY; y += Params.roiShift)
+    {
+        for (int x = Params.roiOffset; x < lastRoiX; x += Params.roiShift)
+        {
+            if(Params.reducedRoi && !Params.reducedRoiComplement)
+            {
+                if (skip <= 0)
+                    skip = Params.skipCount;
+                else
+                {
+                    skip--;
+                    continue;
+                }
+            }
+            if(Params.reducedRoi && Params.reducedRoiComplement)
+            {
+                if (skip <= 0)
+                {
+                    skip = Params.skipCount;
+                    continue;
+                }
+                else
+                {
+                    skip--;
+                }
+            }
+            switch (Params.roiShape)
+            {
+            case 1:
+                circle(Mask,Point(x,y),roiSize/2,roiNr,-1);
+                break;
+            default:
+                int roiLeftTopBorderOffset = roiSize / 2 ;
+                int roiRigthBottomBorderOffset =  roiSize - roiSize / 2 - 1 ;
+                rectangle(Mask, Point(x - roiLeftTopBorderOffset, y - roiLeftTopBorderOffset),
+                    Point(x + roiRigthBottomBorderOffset, y + roiRigthBottomBorderOffset),
+                    roiNr,-1);
+                break;
+            }
+            roiNr++;
+        }
+    }
+    return Mask;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool SameLabel(const LabelStatisticsTable &TableA, const LabelStatisticsTable &TableB, int label)
+{
+    LabelStatistics Empty;
+    const LabelStatistics &A = label < (int)TableA.Labels.size() ? TableA.Labels[label] : Empty;
+    const LabelStatistics &B = label < (int)TableB.Labels.size() ? TableB.Labels[label] : Empty;
+    if(A.area != B.area)
+        return 0;
+    if(!A.area)
+        return 1;
+    // coordinates and values are integers, their sums are exact in double
+    return A.minX == B.minX && A.minY == B.minY && A.maxX == B.maxX && A.maxY == B.maxY &&
+           A.sumX == B.sumX && A.sumY == B.sumY &&
+           A.minValue == B.minValue && A.maxValue == B.maxValue && A.sum == B.sum && A.sumOfSquares == B.sumOfSquares &&
+           A.Histogram == B.Histogram;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool SameStatistics(const LabelStatisticsTable &TableA, const LabelStatisticsTable &TableB)
+{
+    int labelCount = (int)max(TableA.Labels.size(), TableB.Labels.size());
+    for(int label = 1; label < labelCount; label++)
+    {
+        if(!SameLabel(TableA, TableB, label))
+            return 0;
+    }
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool Expect(bool condition, const string &What)
+{
+    cout << (condition ? "ok      " : "FAILED  ") << What << "\n";
+    return condition;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if(argc != 1)
+    {
+        cout << "usage: " << argv[0] << "\n";
+        return 1;
+    }
+
+    const int histogramBins = 64;
+    const int maxValue = 4095;
+    vector<Size> ImSizes = {Size(61, 47), Size(203, 151)};
+    vector<int> RoiSizes = {1, 2, 5, 8, 13};
+    vector<int> RoiOffsets = {-3, 0, 4};
+    vector<int> RoiShifts = {1, 3, 7, 12};
+    vector<int> SkipCounts = {0, 1, 3};
+    vector<int> TileSizes = {5, 16, 1024};
+
+    int gridsCount = 0;
+    int maskFailures = 0;
+    int statisticsFailures = 0;
+    string FirstMaskFailure;
+    string FirstStatisticsFailure;
+    for(Size ImSize : ImSizes)
+    {
+        Mat Im(ImSize, CV_16U);
+        randu(Im, Scalar::all(0), Scalar::all(maxValue + 1));
+        for(int roiShape = 0; roiShape < 2; roiShape++)
+        for(int roiSize : RoiSizes)
+        for(int roiOffset : RoiOffsets)
+        for(int roiShift : RoiShifts)
+        for(int reduction = 0; reduction < 3; reduction++)
+        for(int skipCount : SkipCounts)
+        {
+            GridParams Params;
+            Params.ImSize = ImSize;
+            Params.roiShape = roiShape;
+            Params.roiSize = roiSize;
+            Params.roiOffset = roiOffset;
+            Params.roiShift = roiShift;
+            Params.reducedRoi = reduction > 0;
+            Params.reducedRoiComplement = reduction > 1;
+            Params.skipCount = skipCount;
+            gridsCount++;
+
+            RoiGrid Grid = MakeGrid(Params);
+            Mat Painted = PaintedGrid(Params);
+            Mat Full = Grid.FullIndex().ToMat();
+            Full.convertTo(Full, CV_32S);
+            if(norm(Full, Painted, NORM_INF) != 0.0)
+            {
+                if(!maskFailures++)
+                    FirstMaskFailure = GridParamsText(Params);
+                continue;
+            }
+
+            // the statistics of large grids only, small ones add nothing but time
+            if(ImSize.width < 100)
+                continue;
+            LabelStatisticsTable Reference;
+            ComputeLabelStatistics(Painted, Im, Reference, histogramBins, 0.0, maxValue);
+            for(int tileSize : TileSizes)
+            {
+                LabelStatisticsTable Tiled;
+                ComputeLabelStatistics(Grid, [&](Rect Tile){ return Im(Tile); }, tileSize, Tiled, histogramBins, 0.0, maxValue);
+                if(!SameStatistics(Reference, Tiled))
+                {
+                    if(!statisticsFailures++)
+                        FirstStatisticsFailure = GridParamsText(Params) + " tile " + to_string(tileSize);
+                }
+            }
+        }
+    }
+
+    bool passed = 1;
+    passed &= Expect(!maskFailures, "FullIndex equals the painted mask for " + to_string(gridsCount) + " grids" +
+                                    (maskFailures ? ", first failure " + FirstMaskFailure : string()));
+    passed &= Expect(!statisticsFailures, "tile statistics equal the painted mask statistics for tiles of 5, 16 and 1024" +
+                                          (statisticsFailures ? ", first failure " + FirstStatisticsFailure : string()));
+
+    cout << (passed ? "passed\n" : "FAILED\n");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#include "imagecache.h"
+
+#include <boost/filesystem.hpp>
+
+using namespace boost;
+using namespace std;
+using namespace boost::filesystem;
+using namespace cv;
+
+//------------------------------------------------------------------------------------------------------------------------------
+CachedImage::CachedImage()
+{
+    tiffResolutionValid = 0;
+    xRes = 1.0;
+    yRes = 1.0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+ImageCache::ImageCache(size_t budgetBytes) :
+    budgetBytes(budgetBytes),
+    usedBytes(0)
+{
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string ImageCache::MakeKey(const string &FileName, int flags)
+{
+    return to_string(flags) + "|" + FileName;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool ImageCache::Get(const string &FileName, int flags, CachedImage &Image)
+{
+    boost::system::error_code ec;
+    std::time_t modificationTime = last_write_time(path(FileName), ec);
+    if(ec)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(CacheMutex);
+    auto found = Index.find(MakeKey(FileName, flags));
+    if(found == Index.end())
+        return 0;
+
+    list<Entry>::iterator entry = found->second;
+    if(entry->modificationTime != modificationTime)
+    {
+        usedBytes -= entry->bytes;
+        Entries.erase(entry);
+        Index.erase(found);
+        return 0;
+    }
+
+    Entries.splice(Entries.begin(), Entries, entry);
+    Image = entry->Image;
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void ImageCache::Put(const string &FileName, int flags, const CachedImage &Image)
+{
+    if(Image.Im.empty())
+        return;
+
+    boost::system::error_code ec;
+    std::time_t modificationTime = last_write_time(path(FileName), ec);
+    if(ec)
+        return;
+
+    size_t bytes = Image.Im.total() * Image.Im.elemSize();
+
+    std::lock_guard<std::mutex> lock(CacheMutex);
+    if(bytes > budgetBytes)
+        return;
+
+    string Key = MakeKey(FileName, flags);
+    auto found = Index.find(Key);
+    if(found != Index.end())
+    {
+        usedBytes -= found->second->bytes;
+        Entries.erase(found->second);
+        Index.erase(found);
+    }
+
+    Entry NewEntry;
+    NewEntry.Key = Key;
+    NewEntry.modificationTime = modificationTime;
+    NewEntry.bytes = bytes;
+    NewEntry.Image = Image;
+    Entries.push_front(NewEntry);
+    Index[Key] = Entries.begin();
+    usedBytes += bytes;
+
+    Evict();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void ImageCache::SetBudget(size_t budgetBytes)
+{
+    std::lock_guard<std::mutex> lock(CacheMutex);
+    this->budgetBytes = budgetBytes;
+    Evict();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void ImageCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(CacheMutex);
+    Entries.clear();
+    Index.clear();
+    usedBytes = 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+size_t ImageCache::UsedBytes()
+{
+    std::lock_guard<std::mutex> lock(CacheMutex);
+    return usedBytes;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// called with CacheMutex held
+void ImageCache::Evict()
+{
+    while(usedBytes > budgetBytes && !Entries.empty())
+    {
+        usedBytes -= Entries.back().bytes;
+        Index.erase(Entries.back().Key);
+        Entries.pop_back();
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <string>
+#include <list>
+#include <map>
+#include <mutex>
+#include <ctime>
+
+#include <opencv2/core/core.hpp>
+
+//------------------------------------------------------------------------------------------------------------------------------
+// LRU cache of decoded input images. An entry is valid for one file, one modification time and one
+// set of imread flags, so re-running a mode with new parameters does not touch the disk.
+// Cached images are shared, the processing modes must not write into ImIn.
+//------------------------------------------------------------------------------------------------------------------------------
+struct CachedImage
+{
+    cv::Mat Im;
+    bool tiffResolutionValid;
+    float xRes;
+    float yRes;
+
+    CachedImage();
+};
+//------------------------------------------------------------------------------------------------------------------------------
+class ImageCache
+{
+public:
+    explicit ImageCache(size_t budgetBytes);
+
+    bool Get(const std::string &FileName, int flags, CachedImage &Image);
+    void Put(const std::string &FileName, int flags, const CachedImage &Image);
+    void SetBudget(size_t budgetBytes);
+    void Clear();
+
+    size_t UsedBytes();
+
+private:
+    struct Entry
+    {
+        std::string Key;
+        std::time_t modificationTime;
+        size_t bytes;
+        CachedImage Image;
+    };
+
+    static std::string MakeKey(const std::string &FileName, int flags);
+    void Evict();
+
+    std::mutex CacheMutex;
+    std::list<Entry> Entries;  // most recently used first
+    std::map<std::string, std::list<Entry>::iterator> Index;
+    size_t budgetBytes;
+    size_t usedBytes;
+};
+
+#endif // IMAGECACHE_H
@@ -0,0 +1,101 @@
+// Check of the local job runner against a stub command, no Qt needed. The program is its own stub:
+// "JobCheck -stub mode id shard" behaves like MzGenerator writing one table, mode ok, fail, flaky
+// (fails the first time) or hang. Returns 0 when the success, retry, timeout, failure and merge
+// paths behave as expected.
+// usage: JobCheck [-tmp folder]
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include "commandjobs.h"
+
+using namespace std;
+using namespace boost::filesystem;
+
+//------------------------------------------------------------------------------------------------------------------------------
+int RunStub(const string &Mode, const string &Id, const string &ShardFile)
+{
+    if(Mode == "fail")
+        return 3;
+    if(Mode == "hang")
+        std::this_thread::sleep_for(std::chrono::seconds(60));
+    if(Mode == "flaky")
+    {
+        path Flag = path(ShardFile).parent_path() / ("flaky" + Id);
+        if(!exists(Flag))
+        {
+            std::ofstream(Flag.string()) << "1\n";
+            return 1;
+        }
+    }
+    std::ofstream Out(ShardFile);
+    Out << "Category,Feature\n" << "ROI" << Id << "," << Id << "\n";
+    return 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool Expect(bool condition, const string &What)
+{
+    cout << (condition ? "ok      " : "FAILED  ") << What << "\n";
+    return condition;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if(argc == 5 && string(argv[1]) == "-stub")
+        return RunStub(argv[2], argv[3], argv[4]);
+
+    path TempFolder = temp_directory_path();
+    if(argc == 3 && string(argv[1]) == "-tmp")
+        TempFolder = argv[2];
+    else if(argc != 1)
+    {
+        cout << "usage: " << argv[0] << " [-tmp folder]\n";
+        return 1;
+    }
+    path Folder = TempFolder / unique_path("JobCheck_%%%%%%%%");
+    create_directories(Folder);
+    string Self = absolute(path(argv[0])).string();
+
+    vector<string> Modes = {"ok", "flaky", "ok", "hang", "fail", "ok"};
+    vector<CommandJob> Jobs;
+    vector<string> ShardFiles;
+    for(size_t i = 0; i < Modes.size(); i++)
+    {
+        CommandJob Job;
+        Job.ShardFile = (Folder / ("shard" + to_string(i) + ".cvs")).string();
+        Job.Command = "\"" + Self + "\" -stub " + Modes[i] + " " + to_string(i) + " \"" + Job.ShardFile + "\"";
+        Jobs.push_back(Job);
+        ShardFiles.push_back(Job.ShardFile);
+    }
+
+    vector<CommandJobResult> Results;
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    bool allSucceeded = RunCommandJobs(Jobs, 3, 1.0, 1, Folder.string(), Results);
+    std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - Start;
+
+    bool passed = 1;
+    passed &= Expect(!allSucceeded, "a failed job fails the run");
+    passed &= Expect(Results[0].succeeded && Results[0].attempts == 1, "a good job runs once");
+    passed &= Expect(Results[1].succeeded && Results[1].attempts == 2, "a flaky job succeeds on the retry");
+    passed &= Expect(!Results[3].succeeded && Results[3].timedOut && Results[3].attempts == 2, "a hanging job times out on every attempt");
+    passed &= Expect(!Results[4].succeeded && !Results[4].timedOut && Results[4].exitCode == 3, "a failing job keeps its exit code");
+    passed &= Expect(Elapsed.count() < 30.0, "the timeout kills the hanging job");
+
+    path Merged = Folder / "merged.cvs";
+    passed &= Expect(!MergeShards(ShardFiles, Merged.string(), 1), "the merge reports the missing shards");
+    std::ifstream In(Merged.string());
+    string Text((std::istreambuf_iterator<char>(In)), std::istreambuf_iterator<char>());
+    In.close();
+    passed &= Expect(Text == "Category,Feature\nROI0,0\nROI1,1\nROI2,2\nROI5,5\n", "shards are merged in order under one header");
+
+    cout << FailedCommandJobsAsText(Jobs, Results);
+    boost::system::error_code Error;
+    remove_all(Folder, Error);
+    return passed ? 0 : 1;
+}
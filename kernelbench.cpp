@@ -0,0 +1,300 @@
+// Micro-benchmark of the pixel kernels on synthetic images, no Qt needed.
+// usage: KernelBench [-sizes 1,16,64,256] [-reps N] [-tmp folder]
+// ns/pixel is the best of N runs. bytes/cycle counts input plus output image bytes of the kernel
+// against the time stamp counter (reference cycles), it is not reported where no counter exists.
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+#include <boost/filesystem.hpp>
+#include <boost/random/linear_congruential.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define HAS_CYCLE_COUNTER 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_CYCLE_COUNTER 1
+#else
+#define HAS_CYCLE_COUNTER 0
+#endif
+
+#include "ImageCalculatorLib.h"
+#include "displaystats.h"
+#include "labelstats.h"
+
+using namespace std;
+using namespace boost::filesystem;
+using namespace cv;
+
+//------------------------------------------------------------------------------------------------------------------------------
+unsigned long long CycleCounter()
+{
+#if HAS_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+//------------------------------------------------------------------------------------------------------------------------------
+struct BenchTime
+{
+    double ns;
+    double cycles;
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// best of reps runs after one warm up run
+BenchTime Measure(std::function<void()> Kernel, int reps)
+{
+    Kernel();
+    BenchTime Best;
+    Best.ns = 1e300;
+    Best.cycles = 1e300;
+    for(int i = 0; i < reps; i++)
+    {
+        std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+        unsigned long long startCycles = CycleCounter();
+        Kernel();
+        unsigned long long stopCycles = CycleCounter();
+        std::chrono::duration<double, std::nano> Elapsed = std::chrono::steady_clock::now() - Start;
+        if(Best.ns > Elapsed.count())
+            Best.ns = Elapsed.count();
+        if(Best.cycles > (double)(stopCycles - startCycles))
+            Best.cycles = (double)(stopCycles - startCycles);
+    }
+    return Best;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void PrintRow(string Kernel, string Type, int megaPixels, double pixels, double bytesPerPixel, BenchTime Time)
+{
+    cout << left << setw(26) << Kernel << setw(6) << Type << right << setw(6) << megaPixels
+         << fixed << setprecision(3) << setw(12) << Time.ns / pixels;
+    if(HAS_CYCLE_COUNTER && Time.cycles > 0.0)
+        cout << setw(12) << bytesPerPixel * pixels / Time.cycles;
+    else
+        cout << setw(12) << "n/a";
+    cout << "\n";
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string TypeName(int type)
+{
+    switch(type)
+    {
+    case CV_8U:
+        return "8U";
+    case CV_16U:
+        return "16U";
+    case CV_32S:
+        return "32S";
+    case CV_32F:
+        return "32F";
+    default:
+        return "?";
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Mat SyntheticImage(int side, int type, int channels, int maxValue)
+{
+    Mat Im(side, side, CV_MAKETYPE(type, channels));
+    randu(Im, Scalar::all(0), Scalar::all(maxValue));
+    return Im;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void BenchSize(int megaPixels, int reps, path TempFolder)
+{
+    int side = 1024;
+    while(side * side < megaPixels * 1024 * 1024)
+        side *= 2;
+    double pixels = (double)side * side;
+
+    ImageCalculatorParams Params;
+    DisableDisplay(Params);
+    Params.saveOutput = 0;
+    ImageCalculatorResult Result;
+    boost::minstd_rand RandomEngine(1);
+
+    Mat Im8UC3 = SyntheticImage(side, CV_8U, 3, 256);
+    PrintRow("TiffRoiFromRed", "8UC3", megaPixels, pixels, 3 + 2, Measure([&]{ RoiFromRed(Im8UC3, Params); }, reps));
+    ImageCalculatorParams MaskParams = Params;
+    MaskParams.annotationRule = 2;
+    MaskParams.annotationMaskBits = 8;
+    PrintRow("TiffRoiFromRed key", "8UC3", megaPixels, pixels, 3 + 1, Measure([&]{ RoiFromRed(Im8UC3, MaskParams); }, reps));
+    Im8UC3.release();
+
+    Mat Im16U = SyntheticImage(side, CV_16U, 1, 4096);
+    int normTypes[3] = {CV_8U, CV_16U, CV_32F};
+    for(int type : normTypes)
+    {
+        Mat ImIn = type == CV_16U ? Im16U : SyntheticImage(side, type, 1, type == CV_8U ? 256 : 4096);
+        PrintRow("CreateNormalisedImage16U", TypeName(type), megaPixels, pixels, ImIn.elemSize() + 2,
+                 Measure([&]{ CreateNormalisedImage16U(ImIn, 100.0, 4000.0, 256); }, reps));
+    }
+    PrintRow("RenderForDisplay 1/8", "16U", megaPixels, pixels, 2,
+             Measure([&]{ RenderForDisplay(Im16U, 0.125, 2, 100.0, 4000.0); }, reps));
+    DisplayStatistics Stats;
+    PrintRow("ComputeDisplayStatistics", "16U", megaPixels, pixels, 2,
+             Measure([&]{ ComputeDisplayStatistics(Im16U, Mat(), 0, Stats); }, reps));
+
+    int types[3] = {CV_8U, CV_16U, CV_32S};
+    for(int type : types)
+    {
+        Mat ImIn = SyntheticImage(side, type, 1, type == CV_8U ? 256 : 4096);
+        PrintRow("LinearScale", TypeName(type), megaPixels, pixels, ImIn.elemSize() + 4,
+                 Measure([&]{ LinearScale(ImIn, Params); }, reps));
+    }
+
+    Mat Im32S = SyntheticImage(side, CV_32S, 1, 4096);
+    ImageCalculatorParams NoiseParams = Params;
+    NoiseParams.addNoise = 1;
+    NoiseParams.addUniformNoise = 0;
+    NoiseParams.addRician = 0;
+    PrintRow("GaussianNoise", "32S", megaPixels, pixels, 4 + 4,
+             Measure([&]{ LinearAddNoise(Im32S, NoiseParams, Result, RandomEngine, 0); }, reps));
+    NoiseParams.addNoise = 0;
+    NoiseParams.addUniformNoise = 1;
+    PrintRow("UniformNoise", "32S", megaPixels, pixels, 4 + 4,
+             Measure([&]{ LinearAddNoise(Im32S, NoiseParams, Result, RandomEngine, 0); }, reps));
+    NoiseParams.addUniformNoise = 0;
+    NoiseParams.addRician = 1;
+    PrintRow("RicianNoise", "32S", megaPixels, pixels, 4 + 4,
+             Measure([&]{ LinearAddNoise(Im32S, NoiseParams, Result, RandomEngine, 0); }, reps));
+    ImageCalculatorParams GradientParams = Params;
+    GradientParams.addGradient = 1;
+    GradientParams.gradientDirection = 2;
+    PrintRow("Gradient", "32S", megaPixels, pixels, 4 + 4,
+             Measure([&]{ LinearAddGradient(Im32S, GradientParams); }, reps));
+
+    ImageCalculatorParams FusedParams = GradientParams;
+    FusedParams.addNoise = 1;
+    int fusedTypes[2] = {CV_8U, CV_16U};
+    for(int type : fusedTypes)
+    {
+        Mat ImIn = type == CV_16U ? Im16U : SyntheticImage(side, type, 1, 256);
+        PrintRow("LinearOperationFused", TypeName(type), megaPixels, pixels, ImIn.elemSize() + 2,
+                 Measure([&]{ LinearOperationFused(ImIn, FusedParams, Result, RandomEngine); }, reps));
+    }
+    Im32S.release();
+
+    // about 16k labels whatever the image size, the mask is 16 bit
+    ImageCalculatorParams RoiParams = Params;
+    RoiParams.roiShape = 0;
+    RoiParams.roiSize = side / 128;
+    RoiParams.roiShift = side / 128;
+    RoiParams.roiOffset = side / 256;
+    RoiParams.reducedRoi = 0;
+    RoiMaskStageOut RoiMask;
+    PrintRow("CreateRoiMask", "spans", megaPixels, pixels, 0,
+             Measure([&]{ RoiMask = CreateRoiMask(Size(side, side), RoiParams); }, reps));
+    Mat Mask = RoiMask.Index->ToMat();
+    LabelStatisticsTable Labels;
+    PrintRow("LabelStatistics geometry", "16U", megaPixels, pixels, 2,
+             Measure([&]{ ComputeLabelStatistics(Mask, Mat(), Labels); }, reps));
+    PrintRow("LabelStatistics intensity", "16U", megaPixels, pixels, 2 + 2,
+             Measure([&]{ ComputeLabelStatistics(Mask, Im16U, Labels, 4096, 0.0, 4095.0); }, reps));
+    uint16_t lastRoiNr = (uint16_t)Labels.MaxLabel();
+    RoiIndex Index;
+    PrintRow("RoiIndex build", "16U", megaPixels, pixels, 2,
+             Measure([&]{ Index.Build(Mask); }, reps));
+    PrintRow("CropRoi indexed", "16U", megaPixels, pixels, 2 + 2,
+             Measure([&]{ CropRoi(Im16U, Index, lastRoiNr); }, reps));
+    PrintRow("LabelStatistics spans", "16U", megaPixels, pixels, 2,
+             Measure([&]{ ComputeLabelStatistics(Index, Im16U, Labels, 4096, 0.0, 4095.0); }, reps));
+    PrintRow("RoiIndex contour", "spans", megaPixels, pixels, 0,
+             Measure([&]{ Index.Contour(); }, reps));
+    Mask.release();
+
+    // the dense sampling grid of 8 pixel ROIs, labels pass 65535 from 64 MPix up
+    ImageCalculatorParams DenseParams = RoiParams;
+    DenseParams.roiSize = 8;
+    DenseParams.roiShift = 8;
+    DenseParams.roiOffset = 4;
+    RoiMaskStageOut DenseMask;
+    PrintRow("CreateRoiMask 8 pixel", "spans", megaPixels, pixels, 0,
+             Measure([&]{ DenseMask = CreateRoiMask(Size(side, side), DenseParams); }, reps));
+    PrintRow("LabelStatistics 8 pixel", "16U", megaPixels, pixels, 2,
+             Measure([&]{ ComputeLabelStatistics(*DenseMask.Index, Im16U, Labels); }, reps));
+    DenseMask = RoiMaskStageOut();
+    RoiGrid DenseGrid = CreateRoiGrid(Size(side, side), DenseParams);
+    PrintRow("LabelStatistics 8 px tiles", "16U", megaPixels, pixels, 2,
+             Measure([&]{ ComputeLabelStatistics(DenseGrid, [&](Rect Tile){ return Im16U(Tile); }, 1024, Labels); }, reps));
+
+    // a handful of large ROIs written by CreateROI, read back by LoadROI
+    if(!TempFolder.empty())
+    {
+        ImageCalculatorParams SaveParams = RoiParams;
+        SaveParams.roiSize = side / 4;
+        SaveParams.roiShift = side / 4;
+        SaveParams.roiOffset = side / 8;
+        SaveParams.saveRoiBmp = 0;
+        SaveParams.saveRoiHistogram = 0;
+        SaveParams.saveStatistics = 0;
+        SaveParams.saveNormalisedRoiImage = 0;
+        SaveParams.saveBinnedRoiImage = 0;
+        SaveParams.saveRoi = 1;
+        SaveParams.OutFolder = TempFolder.string();
+
+        path Stem = TempFolder;
+        Stem.append("KernelBench" + to_string(side) + ".tif");
+        ImageCalculatorResult SaveResult;
+        SaveResult.FileName = Stem.string();
+        SaveResult.ImIn = Im16U;
+        CreateROI(SaveParams, SaveResult);
+
+        path RoiFile;
+        for (directory_entry& FileToProcess : directory_iterator(TempFolder))
+        {
+            string FileName = FileToProcess.path().filename().string();
+            if(FileName.find("KernelBench" + to_string(side)) == 0 && FileToProcess.path().extension() == ".roi")
+                RoiFile = FileToProcess.path();
+        }
+        if(!RoiFile.empty())
+        {
+            PrintRow("LoadROI", "16U", megaPixels, pixels, 2,
+                     Measure([&]{ LoadROI(RoiFile, side, side); }, reps));
+            boost::system::error_code ec;
+            remove(RoiFile, ec);
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    vector<int> Sizes = {1, 16, 64, 256};
+    int reps = 3;
+    path TempFolder = temp_directory_path();
+
+    for(int i = 1; i < argc; i++)
+    {
+        string Arg = argv[i];
+        if(Arg == "-sizes" && i + 1 < argc)
+        {
+            Sizes.clear();
+            stringstream List(argv[++i]);
+            string Item;
+            while(getline(List, Item, ','))
+                Sizes.push_back(stoi(Item));
+        }
+        else if(Arg == "-reps" && i + 1 < argc)
+            reps = stoi(argv[++i]);
+        else if(Arg == "-tmp" && i + 1 < argc)
+            TempFolder = argv[++i];
+        else
+        {
+            cout << "usage: " << argv[0] << " [-sizes 1,16,64,256] [-reps N] [-tmp folder]\n";
+            return 1;
+        }
+    }
+
+    cout << left << setw(26) << "kernel" << setw(6) << "type" << right << setw(6) << "MPix"
+         << setw(12) << "ns/pixel" << setw(12) << "bytes/cycle" << "\n";
+    for(int megaPixels : Sizes)
+        BenchSize(megaPixels, reps, TempFolder);
+    return 0;
+}
@@ -0,0 +1,416 @@
+#include "labelstats.h"
+
+#include <algorithm>
+#include <climits>
+#include <sstream>
+#include <math.h>
+
+using namespace std;
+using namespace cv;
+
+//------------------------------------------------------------------------------------------------------------------------------
+LabelStatistics::LabelStatistics() :
+    area(0),
+    minX(INT_MAX),
+    minY(INT_MAX),
+    maxX(-1),
+    maxY(-1),
+    sumX(0.0),
+    sumY(0.0),
+    minValue(HUGE_VAL),
+    maxValue(-HUGE_VAL),
+    sum(0.0),
+    sumOfSquares(0.0)
+{
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Rect LabelStatistics::BoundingBox() const
+{
+    if(!area)
+        return Rect();
+    return Rect(minX, minY, maxX - minX + 1, maxY - minY + 1);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+double LabelStatistics::CentroidX() const
+{
+    return area ? sumX / (double)area : 0.0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+double LabelStatistics::CentroidY() const
+{
+    return area ? sumY / (double)area : 0.0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+double LabelStatistics::Mean() const
+{
+    return area ? sum / (double)area : 0.0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+double LabelStatistics::Std() const
+{
+    if(!area)
+        return 0.0;
+    double mean = Mean();
+    double variance = sumOfSquares / (double)area - mean * mean;
+    return variance > 0.0 ? sqrt(variance) : 0.0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+LabelStatisticsTable::LabelStatisticsTable() :
+    withIntensity(0),
+    histogramBins(0),
+    histogramStart(0.0),
+    histogramBinWidth(1.0)
+{
+}
+//------------------------------------------------------------------------------------------------------------------------------
+int LabelStatisticsTable::MaxLabel() const
+{
+    for(int label = (int)Labels.size() - 1; label > 0; label--)
+    {
+        if(Labels[label].area)
+            return label;
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool LabelStatisticsTable::Contains(int label) const
+{
+    return label >= 0 && label < (int)Labels.size() && Labels[label].area;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// lowest bin start with at least fraction of the label area at or below it
+double LabelStatisticsTable::Percentile(int label, double fraction) const
+{
+    if(!Contains(label) || Labels[label].Histogram.empty())
+        return 0.0;
+    const LabelStatistics &Label = Labels[label];
+    double limit = fraction * (double)Label.area;
+    uint64_t cumulated = 0;
+    for(size_t bin = 0; bin < Label.Histogram.size(); bin++)
+    {
+        cumulated += Label.Histogram[bin];
+        if(cumulated && (double)cumulated >= limit)
+            return min(max(histogramStart + (double)bin * histogramBinWidth, Label.minValue), Label.maxValue);
+    }
+    return Label.maxValue;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void SetHistogramRange(LabelStatisticsTable &Table, int histogramBins, double histogramMin, double histogramMax)
+{
+    if(histogramBins > 0)
+    {
+        Table.histogramBins = histogramBins;
+        Table.histogramStart = histogramMin;
+        Table.histogramBinWidth = histogramMax > histogramMin ? (histogramMax - histogramMin + 1.0) / histogramBins : 1.0;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// adds the pixels of rows firstRow .. lastRow - 1 to Labels, which grows to the largest label found
+template<class M, class T>
+void AccumulateLabelRows(const Mat &Mask, const Mat &Im, int firstRow, int lastRow, const LabelStatisticsTable &Table,
+                         int histogramBins, vector<LabelStatistics> &Labels)
+{
+    double binScale = 1.0 / Table.histogramBinWidth;
+    for(int y = firstRow; y < lastRow; y++)
+    {
+        const M *wMask = Mask.ptr<M>(y);
+        const T *wIm = Im.empty() ? 0 : Im.ptr<T>(y);
+        for(int x = 0; x < Mask.cols; x++)
+        {
+            int label = (int)wMask[x];
+            if(label < 0)
+                continue;
+            if(label >= (int)Labels.size())
+                Labels.resize(label + 1);
+            LabelStatistics &Label = Labels[label];
+            Label.area++;
+            Label.minX = min(Label.minX, x);
+            Label.maxX = max(Label.maxX, x);
+            Label.minY = min(Label.minY, y);
+            Label.maxY = y;
+            Label.sumX += x;
+            Label.sumY += y;
+            if(!wIm)
+                continue;
+
+            double value = (double)wIm[x];
+            Label.sum += value;
+            Label.sumOfSquares += value * value;
+            if(Label.minValue > value)
+                Label.minValue = value;
+            if(Label.maxValue < value)
+                Label.maxValue = value;
+            if(histogramBins > 0)
+            {
+                if(Label.Histogram.empty())
+                    Label.Histogram.resize(histogramBins);
+                int bin = (int)floor((value - Table.histogramStart) * binScale);
+                Label.Histogram[min(max(bin, 0), histogramBins - 1)]++;
+            }
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+template<class M>
+void AccumulateLabels(const Mat &Mask, const Mat &Im, int firstRow, int lastRow, const LabelStatisticsTable &Table,
+                      int histogramBins, vector<LabelStatistics> &Labels)
+{
+    switch(Im.empty() ? CV_16U : Im.depth())
+    {
+    case CV_8U:
+        AccumulateLabelRows<M, uint8_t>(Mask, Im, firstRow, lastRow, Table, histogramBins, Labels);
+        break;
+    case CV_16U:
+        AccumulateLabelRows<M, uint16_t>(Mask, Im, firstRow, lastRow, Table, histogramBins, Labels);
+        break;
+    case CV_16S:
+        AccumulateLabelRows<M, int16_t>(Mask, Im, firstRow, lastRow, Table, histogramBins, Labels);
+        break;
+    case CV_32S:
+        AccumulateLabelRows<M, int32_t>(Mask, Im, firstRow, lastRow, Table, histogramBins, Labels);
+        break;
+    case CV_32F:
+        AccumulateLabelRows<M, float>(Mask, Im, firstRow, lastRow, Table, histogramBins, Labels);
+        break;
+    default:
+        AccumulateLabelRows<M, double>(Mask, Im, firstRow, lastRow, Table, histogramBins, Labels);
+        break;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool ComputeLabelStatistics(Mat Mask, Mat Im, LabelStatisticsTable &Table, int histogramBins, double histogramMin, double histogramMax)
+{
+    Table = LabelStatisticsTable();
+    if(Mask.empty() || (Mask.type() != CV_16U && Mask.type() != CV_32S))
+        return 0;
+    if(!Im.empty() && (Im.channels() != 1 || Im.size() != Mask.size()))
+        return 0;
+
+    Table.withIntensity = !Im.empty();
+    if(!Table.withIntensity)
+        histogramBins = 0;
+    SetHistogramRange(Table, histogramBins, histogramMin, histogramMax);
+
+    int stripesCount = min(max(getNumThreads(), 1), Mask.rows);
+    vector<vector<LabelStatistics>> Stripes(stripesCount);
+    parallel_for_(Range(0, stripesCount), [&](const Range &StripeRange)
+    {
+        for(int stripe = StripeRange.start; stripe < StripeRange.end; stripe++)
+        {
+            int firstRow = (int)((int64_t)Mask.rows * stripe / stripesCount);
+            int lastRow = (int)((int64_t)Mask.rows * (stripe + 1) / stripesCount);
+            if(Mask.type() == CV_16U)
+                AccumulateLabels<uint16_t>(Mask, Im, firstRow, lastRow, Table, histogramBins, Stripes[stripe]);
+            else
+                AccumulateLabels<int32_t>(Mask, Im, firstRow, lastRow, Table, histogramBins, Stripes[stripe]);
+        }
+    });
+
+    // stripes are in row order, so the merged sums are the same for any thread count
+    for(vector<LabelStatistics> &Stripe : Stripes)
+    {
+        if(Stripe.size() > Table.Labels.size())
+            Table.Labels.resize(Stripe.size());
+        for(size_t label = 0; label < Stripe.size(); label++)
+        {
+            const LabelStatistics &Part = Stripe[label];
+            if(!Part.area)
+                continue;
+            LabelStatistics &Label = Table.Labels[label];
+            Label.area += Part.area;
+            Label.minX = min(Label.minX, Part.minX);
+            Label.maxX = max(Label.maxX, Part.maxX);
+            Label.minY = min(Label.minY, Part.minY);
+            Label.maxY = max(Label.maxY, Part.maxY);
+            Label.sumX += Part.sumX;
+            Label.sumY += Part.sumY;
+            Label.sum += Part.sum;
+            Label.sumOfSquares += Part.sumOfSquares;
+            Label.minValue = min(Label.minValue, Part.minValue);
+            Label.maxValue = max(Label.maxValue, Part.maxValue);
+            if(!Part.Histogram.empty())
+            {
+                if(Label.Histogram.empty())
+                    Label.Histogram.resize(Part.Histogram.size());
+                for(size_t bin = 0; bin < Part.Histogram.size(); bin++)
+                    Label.Histogram[bin] += Part.Histogram[bin];
+            }
+        }
+    }
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// adds ROI roiNr of the index to Label; the index and Im cover the image area starting at Origin
+template<class T>
+void AccumulateRoiSpans(const RoiIndex &Index, const Mat &Im, int roiNr, Point Origin, const LabelStatisticsTable &Table,
+                        int histogramBins, LabelStatistics &Label)
+{
+    double binScale = 1.0 / Table.histogramBinWidth;
+    Rect Box = Index.BoundingBox(roiNr) + Origin;
+    Label.area += Index.Area(roiNr);
+    Label.minX = min(Label.minX, Box.x);
+    Label.minY = min(Label.minY, Box.y);
+    Label.maxX = max(Label.maxX, Box.x + Box.width - 1);
+    Label.maxY = max(Label.maxY, Box.y + Box.height - 1);
+    if(histogramBins > 0 && Label.Histogram.empty())
+        Label.Histogram.resize(histogramBins);
+    Index.ForEachSpan(roiNr, [&](const RoiSpan &Span)
+    {
+        double length = Span.xEnd - Span.xStart;
+        Label.sumX += length * (Span.xStart + Span.xEnd - 1 + 2 * Origin.x) * 0.5;
+        Label.sumY += length * (Span.y + Origin.y);
+        if(Im.empty())
+            return;
+
+        const T *wIm = Im.ptr<T>(Span.y);
+        for(int x = Span.xStart; x < Span.xEnd; x++)
+        {
+            double value = (double)wIm[x];
+            Label.sum += value;
+            Label.sumOfSquares += value * value;
+            if(Label.minValue > value)
+                Label.minValue = value;
+            if(Label.maxValue < value)
+                Label.maxValue = value;
+            if(histogramBins > 0)
+            {
+                int bin = (int)floor((value - Table.histogramStart) * binScale);
+                Label.Histogram[min(max(bin, 0), histogramBins - 1)]++;
+            }
+        }
+    });
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void AccumulateRoi(const RoiIndex &Index, const Mat &Im, int roiNr, Point Origin, const LabelStatisticsTable &Table,
+                   int histogramBins, LabelStatistics &Label)
+{
+    switch(Im.empty() ? CV_16U : Im.depth())
+    {
+    case CV_8U:
+        AccumulateRoiSpans<uint8_t>(Index, Im, roiNr, Origin, Table, histogramBins, Label);
+        break;
+    case CV_16U:
+        AccumulateRoiSpans<uint16_t>(Index, Im, roiNr, Origin, Table, histogramBins, Label);
+        break;
+    case CV_16S:
+        AccumulateRoiSpans<int16_t>(Index, Im, roiNr, Origin, Table, histogramBins, Label);
+        break;
+    case CV_32S:
+        AccumulateRoiSpans<int32_t>(Index, Im, roiNr, Origin, Table, histogramBins, Label);
+        break;
+    case CV_32F:
+        AccumulateRoiSpans<float>(Index, Im, roiNr, Origin, Table, histogramBins, Label);
+        break;
+    default:
+        AccumulateRoiSpans<double>(Index, Im, roiNr, Origin, Table, histogramBins, Label);
+        break;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool ComputeLabelStatistics(const RoiIndex &Index, Mat Im, LabelStatisticsTable &Table, int histogramBins, double histogramMin, double histogramMax)
+{
+    Table = LabelStatisticsTable();
+    if(!Im.empty() && (Im.channels() != 1 || Im.size() != Index.MaskSize()))
+        return 0;
+
+    Table.withIntensity = !Im.empty();
+    if(!Table.withIntensity)
+        histogramBins = 0;
+    SetHistogramRange(Table, histogramBins, histogramMin, histogramMax);
+
+    Table.Labels.resize(Index.MaxRoiNr() + 1);
+    parallel_for_(Range(1, Index.MaxRoiNr() + 1), [&](const Range &Rois)
+    {
+        for(int roiNr = Rois.start; roiNr < Rois.end; roiNr++)
+        {
+            if(Index.Contains(roiNr))
+                AccumulateRoi(Index, Im, roiNr, Point(0, 0), Table, histogramBins, Table.Labels[roiNr]);
+        }
+    });
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// Tiles in row order, the ROIs of a tile in parallel. A ROI crossing tiles is added to by each of
+// them in turn, so the sums are the same for any tile size up to rounding.
+bool ComputeLabelStatistics(const RoiGrid &Grid, std::function<Mat(Rect)> ReadTile, int tileSize, LabelStatisticsTable &Table,
+                            int histogramBins, double histogramMin, double histogramMax)
+{
+    Table = LabelStatisticsTable();
+    if(tileSize <= 0)
+        return 0;
+
+    Table.withIntensity = (bool)ReadTile;
+    if(!Table.withIntensity)
+        histogramBins = 0;
+    SetHistogramRange(Table, histogramBins, histogramMin, histogramMax);
+
+    Size ImSize = Grid.MaskSize();
+    Table.Labels.resize(Grid.MaxRoiNr() + 1);
+    RoiIndex TileIndex;
+    vector<int> RoiNrs;
+    for(int tileY = 0; tileY < ImSize.height; tileY += tileSize)
+    {
+        for(int tileX = 0; tileX < ImSize.width; tileX += tileSize)
+        {
+            Rect Tile = Rect(tileX, tileY, tileSize, tileSize) & Rect(Point(0, 0), ImSize);
+            Grid.TileIndex(Tile, TileIndex, RoiNrs);
+            if(!TileIndex.MaxRoiNr())
+                continue;
+            Mat TileIm;
+            if(ReadTile)
+            {
+                TileIm = ReadTile(Tile);
+                if(TileIm.channels() != 1 || TileIm.size() != Tile.size())
+                    return 0;
+            }
+            parallel_for_(Range(1, TileIndex.MaxRoiNr() + 1), [&](const Range &Rois)
+            {
+                for(int roiNr = Rois.start; roiNr < Rois.end; roiNr++)
+                {
+                    if(TileIndex.Contains(roiNr))
+                        AccumulateRoi(TileIndex, TileIm, roiNr, Tile.tl(), Table, histogramBins, Table.Labels[RoiNrs[roiNr - 1]]);
+                }
+            });
+        }
+    }
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string LabelStatisticsHeader(bool withIntensity, bool withHistograms)
+{
+    string Header = "File Name\tROI Nr\tArea\tMin X\tMin Y\tMax X\tMax Y\tCentroid X\tCentroid Y";
+    if(withIntensity)
+    {
+        Header += "\tMin\tMax\tMean\tStd";
+        if(withHistograms)
+            Header += "\tP1\tP99";
+    }
+    return Header + "\n";
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string LabelStatisticsHeader(const LabelStatisticsTable &Table)
+{
+    return LabelStatisticsHeader(Table.withIntensity, Table.histogramBins > 0);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+string LabelStatisticsAsText(const string &FileName, const LabelStatisticsTable &Table)
+{
+    ostringstream Out;
+    for(int label = 1; label < (int)Table.Labels.size(); label++)
+    {
+        const LabelStatistics &Label = Table.Labels[label];
+        if(!Label.area)
+            continue;
+        Out << FileName << "\t" << label << "\t" << Label.area << "\t"
+            << Label.minX << "\t" << Label.minY << "\t" << Label.maxX << "\t" << Label.maxY << "\t"
+            << Label.CentroidX() << "\t" << Label.CentroidY();
+        if(Table.withIntensity)
+        {
+            Out << "\t" << Label.minValue << "\t" << Label.maxValue << "\t" << Label.Mean() << "\t" << Label.Std();
+            if(Table.histogramBins > 0)
+                Out << "\t" << Table.Percentile(label, 0.01) << "\t" << Table.Percentile(label, 0.99);
+        }
+        Out << "\n";
+    }
+    return Out.str();
+}
@@ -0,0 +1,77 @@
+#ifndef LABELSTATS_H
+#define LABELSTATS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include <opencv2/core/core.hpp>
+
+#include "roiindex.h"
+#include "roigrid.h"
+
+//------------------------------------------------------------------------------------------------------------------------------
+// Geometry and intensity statistics of one label of a label mask
+//------------------------------------------------------------------------------------------------------------------------------
+struct LabelStatistics
+{
+    uint64_t area;
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+    double sumX;
+    double sumY;
+
+    double minValue;
+    double maxValue;
+    double sum;
+    double sumOfSquares;
+    std::vector<uint32_t> Histogram;    // empty when the table was made without histograms
+
+    LabelStatistics();
+    cv::Rect BoundingBox() const;
+    double CentroidX() const;
+    double CentroidY() const;
+    double Mean() const;
+    double Std() const;
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// Statistics of every label of a mask, indexed by the label. Label 0 is the background.
+//------------------------------------------------------------------------------------------------------------------------------
+struct LabelStatisticsTable
+{
+    std::vector<LabelStatistics> Labels;
+    bool withIntensity;
+    int histogramBins;                  // 0 when the table was made without histograms
+    double histogramStart;              // bin i holds values from histogramStart + i * histogramBinWidth
+    double histogramBinWidth;
+
+    LabelStatisticsTable();
+    int MaxLabel() const;               // largest label with a non zero area
+    bool Contains(int label) const;
+    double Percentile(int label, double fraction) const;
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// One row parallel pass over a 16U or 32S mask and, when not empty, a single channel image of the same size.
+// histogramBins > 0 adds a histogram of histogramBins bins over [histogramMin, histogramMax] to every label.
+bool ComputeLabelStatistics(cv::Mat Mask, cv::Mat Im, LabelStatisticsTable &Table,
+                            int histogramBins = 0, double histogramMin = 0.0, double histogramMax = 65535.0);
+// The same from a run length mask, ROIs in parallel, reading only the pixels of the ROIs.
+// The background label 0 is left empty.
+bool ComputeLabelStatistics(const RoiIndex &Index, cv::Mat Im, LabelStatisticsTable &Table,
+                            int histogramBins = 0, double histogramMin = 0.0, double histogramMax = 65535.0);
+// The same for an analytic grid, tile by tile: only the ROIs of one tileSize x tileSize tile are
+// rasterised at a time and ReadTile is asked for the pixels of that tile, so the image can be streamed.
+// An empty ReadTile gives geometry only.
+bool ComputeLabelStatistics(const RoiGrid &Grid, std::function<cv::Mat(cv::Rect)> ReadTile, int tileSize, LabelStatisticsTable &Table,
+                            int histogramBins = 0, double histogramMin = 0.0, double histogramMax = 65535.0);
+
+// one tab separated line per label > 0, with the intensity columns when the table has them and
+// the 1 and 99 percentile when it has histograms; the header lists the same columns
+std::string LabelStatisticsHeader(bool withIntensity, bool withHistograms);
+std::string LabelStatisticsHeader(const LabelStatisticsTable &Table);
+std::string LabelStatisticsAsText(const std::string &FileName, const LabelStatisticsTable &Table);
+
+#endif // LABELSTATS_H
@@ -1,8 +1,14 @@
 #include "mainwindow.h"
 #include <QApplication>
 
+#include "batchrunner.h"
+
 int main(int argc, char *argv[])
 {
+    // -batch selects the headless batch mode, no QApplication is created; other arguments go to Qt
+    if(IsBatchCommandLine(argc, argv))
+        return RunBatch(argc, argv);
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
@@ -3,16 +3,22 @@
 
 #include <QMainWindow>
 
+#include <thread>
+#include <atomic>
+
 #include <boost/filesystem.hpp>
 
 
 #include <opencv2/core/core.hpp>
 
-#include <boost/random/normal_distribution.hpp>
-#include <boost/random/uniform_int.hpp>
-#include <boost/random/variate_generator.hpp>
 #include <boost/random/linear_congruential.hpp>
 
+#include "ImageCalculatorLib.h"
+#include "backgroundprocessor.h"
+#include "filecatalog.h"
+
+class QSocketNotifier;
+
 namespace Ui {
 class MainWindow;
 }
@@ -21,9 +27,6 @@ class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
-public:
-    static boost::variate_generator<boost::minstd_rand&, boost::normal_distribution<>>* RandomGen1();
-
 public:
     boost::filesystem::path ImageFolder;
     boost::filesystem::path OutFolder;
@@ -41,8 +44,6 @@ public:
     double displayScale;
     double xPixelSize;
 
-    bool showInImage;
-
     double resizeScale;
 
     double xPixSizeOut;
@@ -51,16 +52,16 @@ public:
 
     bool ready;
 
-    double minIm;
-    double maxIm;
+    boost::minstd_rand RandomEngine;
 
-    boost::minstd_rand* rngNormalDist;
-    boost::normal_distribution<>* normalDistribution;
-    boost::variate_generator<boost::minstd_rand&, boost::normal_distribution<>>* RandomGenNormDistribution;
+    BackgroundProcessor *Processor;
 
-    boost::minstd_rand* rngUniformDist;
-    boost::uniform_int<>* uniformDistribution;
-    boost::variate_generator<boost::minstd_rand&, boost::uniform_int<>>* RandomGenUniformDistribution;
+    FileCatalog ImageCatalog;
+    QSocketNotifier *CatalogNotifier;
+
+    // Process All runs ProcessFileList on its own thread, the GUI stays responsive
+    std::thread ProcessAllThread;
+    std::atomic<bool> processAllCancelRequested;
 
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
@@ -68,24 +69,23 @@ public:
 
 
     void OpenImageFolder();
-    void ReadImage();
-    void GetDisplayRange(cv::Mat Im, int dispMode, double *minDisp, double *maxDisp);
-    void GetDisplayRange(cv::Mat Im, cv::Mat Mask, uint16_t RoiNr, int dispMode, double *minDisp, double *maxDisp);
-    void ShowsScaledImage(cv::Mat Im, std::string ImWindowName, double dispScale, int dispMode = 0);
-    void ShowsScaledImage(cv::Mat Im, cv::Mat Mask, std::string ImWindowName, double dispScale, uint16_t RoiNr, int dispMode );
-    void SaveScaledImage(cv::Mat Im, std::string FileName, double dispScale,int dispMode);
-    void SaveScaledImage(cv::Mat Im, cv::Mat Mask, std::string FileName, double dispScale, uint16_t RoiNr, int dispMode );
+    void ShowImageFileList();
+    ImageCalculatorParams GetParams();
+    void ShowResult(ImageCalculatorResult &Result);
 
     void ModeSelect();
-    void TiffRoiFromRed();
-    void ImageResize();
-    void ImageLinearOperation();
-    void CreateROI();
-    std::string CreateMaZdaScript();
-    void ViewRoi();
     //void GetDisplayParams(Mat ImIn, double maxIm, double minIm);
 
+signals:
+    void ModeSelectFinished();
+    void ProcessAllProgress(QString FileLog);
+    void ProcessAllFinished(QString Log, QString Report);
+
 private slots:
+    void OnModeSelectFinished();
+    void OnProcessAllProgress(QString FileLog);
+    void OnProcessAllFinished(QString Log, QString Report);
+    void OnImageFolderChanged();
 
     void on_pushButtonOpenImageFolder_clicked();
 
@@ -182,6 +182,8 @@ private slots:
 
     void on_pushButtonProcessAll_clicked();
 
+    void on_pushButtonCancelProcessAll_clicked();
+
     void on_lineEditMaZdaOptionsFile_returnPressed();
 
     void on_checkBoxFixtRangeHistogram_toggled(bool checked);
@@ -212,6 +214,18 @@ private slots:
 
     void on_checkBoxVewSaveRoiBinnedHistogram_toggled(bool checked);
 
+    void on_comboBoxAnnotationRule_currentIndexChanged(int index);
+
+    void on_spinBoxAnnotationKeyR_valueChanged(int arg1);
+
+    void on_spinBoxAnnotationKeyG_valueChanged(int arg1);
+
+    void on_spinBoxAnnotationKeyB_valueChanged(int arg1);
+
+    void on_spinBoxAnnotationTolerance_valueChanged(int arg1);
+
+    void on_comboBoxAnnotationMaskBits_currentIndexChanged(int index);
+
 private:
     Ui::MainWindow *ui;
 
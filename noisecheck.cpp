@@ -0,0 +1,111 @@
+// Check of the counter based noise, no Qt needed. Philox4x32-10 against the Random123 known answers,
+// then LinearAddNoise and LinearOperationFused run with 1 .. 8 threads must give identical images.
+// Returns 0 when every check passes.
+// usage: NoiseCheck
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <boost/random/linear_congruential.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#include "ImageCalculatorLib.h"
+#include "philoxrng.h"
+
+using namespace std;
+using namespace cv;
+
+//------------------------------------------------------------------------------------------------------------------------------
+bool Expect(bool condition, const string &What)
+{
+    cout << (condition ? "ok      " : "FAILED  ") << What << "\n";
+    return condition;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool KnownAnswer(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint32_t k0, uint32_t k1,
+                 uint32_t o0, uint32_t o1, uint32_t o2, uint32_t o3)
+{
+    uint32_t Counter[4] = {c0, c1, c2, c3};
+    uint32_t Out[4];
+    PhiloxRounds(Counter, PhiloxKey(k0, k1), Out);
+    return Out[0] == o0 && Out[1] == o1 && Out[2] == o2 && Out[3] == o3;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool SameImage(Mat ImA, Mat ImB)
+{
+    if(ImA.size() != ImB.size() || ImA.type() != ImB.type())
+        return 0;
+    return norm(ImA, ImB, NORM_INF) == 0.0;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if(argc != 1)
+    {
+        cout << "usage: " << argv[0] << "\n";
+        return 1;
+    }
+
+    bool passed = 1;
+    passed &= Expect(KnownAnswer(0, 0, 0, 0, 0, 0,
+                                 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8), "Philox4x32-10 zero counter and key");
+    passed &= Expect(KnownAnswer(0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+                                 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd), "Philox4x32-10 all ones counter and key");
+    passed &= Expect(KnownAnswer(0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xa4093822, 0x299f31d0,
+                                 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1), "Philox4x32-10 digits of pi counter and key");
+
+    // a run starting inside a block gives the same values as the whole run
+    vector<double> Whole(37);
+    vector<double> Part(30);
+    PhiloxNormals(PhiloxKey(7, 1), 100, (int)Whole.size(), Whole.data());
+    PhiloxNormals(PhiloxKey(7, 1), 107, (int)Part.size(), Part.data());
+    passed &= Expect(equal(Part.begin(), Part.end(), Whole.begin() + 7), "normals do not depend on where a run starts");
+
+    // odd sizes so that rows do not start on block boundaries
+    Mat Im16U(389, 517, CV_16U);
+    randu(Im16U, Scalar::all(0), Scalar::all(4096));
+    Mat Im32S;
+    Im16U.convertTo(Im32S, CV_32S);
+
+    ImageCalculatorParams Params;
+    DisableDisplay(Params);
+    Params.saveOutput = 0;
+    Params.addNoise = 1;
+    Params.gaussNoiseSigma = 30.0;
+    Params.addUniformNoise = 1;
+    Params.uniformNoiseStart = -20;
+    Params.uniformNoiseStop = 20;
+    Params.addRician = 1;
+    Params.ricianS = 10.0;
+    Params.addGradient = 1;
+    Params.gradientDirection = 2;
+
+    int defaultThreads = getNumThreads();
+    Mat NoisyReference;
+    Mat FusedReference;
+    for(int threads = 1; threads <= 8; threads++)
+    {
+        setNumThreads(threads);
+        ImageCalculatorResult Result;
+        boost::minstd_rand RandomEngine(1);
+        Mat Noisy = LinearAddNoise(Im32S, Params, Result, RandomEngine, 0).Im;
+        RandomEngine.seed(1);
+        Mat Fused = LinearOperationFused(Im16U, Params, Result, RandomEngine);
+        if(threads == 1)
+        {
+            NoisyReference = Noisy;
+            FusedReference = Fused;
+            passed &= Expect(!SameImage(Noisy, Im32S), "LinearAddNoise changes the image");
+            continue;
+        }
+        passed &= Expect(SameImage(Noisy, NoisyReference), "LinearAddNoise with " + to_string(threads) + " threads equals 1 thread");
+        passed &= Expect(SameImage(Fused, FusedReference), "LinearOperationFused with " + to_string(threads) + " threads equals 1 thread");
+    }
+    setNumThreads(defaultThreads);
+
+    cout << (passed ? "passed\n" : "FAILED\n");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+#include "normalisationlut.h"
+
+#include <list>
+#include <mutex>
+#include <math.h>
+
+using namespace std;
+
+namespace
+{
+//------------------------------------------------------------------------------------------------------------------------------
+struct CachedTable
+{
+    double minNorm;
+    double maxNorm;
+    int nrOfBins;
+    int valueCount;
+    shared_ptr<const NormalisationTable> Table;
+};
+
+const size_t maxCachedTables = 16;
+
+std::mutex TablesMutex;
+list<CachedTable> Tables;  // most recently used first
+}
+//------------------------------------------------------------------------------------------------------------------------------
+shared_ptr<const NormalisationTable> GetNormalisationTable(double minNorm, double maxNorm, int nrOfBins, int valueCount)
+{
+    {
+        std::lock_guard<std::mutex> lock(TablesMutex);
+        for(auto Cached = Tables.begin(); Cached != Tables.end(); ++Cached)
+        {
+            if(Cached->minNorm == minNorm && Cached->maxNorm == maxNorm &&
+               Cached->nrOfBins == nrOfBins && Cached->valueCount == valueCount)
+            {
+                Tables.splice(Tables.begin(), Tables, Cached);
+                return Tables.front().Table;
+            }
+        }
+    }
+
+    double maxVal = (double)(nrOfBins-1);
+    double offset = minNorm;
+    double normRange = maxNorm - minNorm;
+    if(normRange == 0.0)
+        normRange = 1.0;
+    double coeff = maxVal/normRange;
+
+    shared_ptr<NormalisationTable> Table = make_shared<NormalisationTable>(valueCount);
+    for(int i = 0; i < valueCount; i++)
+    {
+        double val = ((double)i - offset) * coeff;
+        if(val > maxVal)
+            val = maxVal;
+        if(val < 0)
+            val = 0;
+        (*Table)[i] = (uint16_t)round(val);
+    }
+
+    CachedTable NewTable;
+    NewTable.minNorm = minNorm;
+    NewTable.maxNorm = maxNorm;
+    NewTable.nrOfBins = nrOfBins;
+    NewTable.valueCount = valueCount;
+    NewTable.Table = Table;
+
+    std::lock_guard<std::mutex> lock(TablesMutex);
+    Tables.push_front(NewTable);
+    if(Tables.size() > maxCachedTables)
+        Tables.pop_back();
+    return Table;
+}
@@ -0,0 +1,18 @@
+#ifndef NORMALISATIONLUT_H
+#define NORMALISATIONLUT_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+//------------------------------------------------------------------------------------------------------------------------------
+// Mapping of every possible 8 or 16 bit input value to its bin for one (minNorm, maxNorm, nrOfBins),
+// equal to the per pixel round((val - minNorm) * (nrOfBins - 1) / (maxNorm - minNorm)) clamped to
+// the bin range. The last mappings are cached, repeated binning with the same parameters only
+// pays the table pass. Thread safe.
+//------------------------------------------------------------------------------------------------------------------------------
+typedef std::vector<uint16_t> NormalisationTable;
+
+std::shared_ptr<const NormalisationTable> GetNormalisationTable(double minNorm, double maxNorm, int nrOfBins, int valueCount);
+
+#endif // NORMALISATIONLUT_H
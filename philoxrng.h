@@ -0,0 +1,99 @@
+#ifndef PHILOXRNG_H
+#define PHILOXRNG_H
+
+#include <stdint.h>
+#include <math.h>
+
+//------------------------------------------------------------------------------------------------------------------------------
+// Counter based random numbers, Philox4x32-10 (Salmon et al., Random123). Every value is a pure
+// function of (key, stream, index), so an image can be filled in any order by any number of threads
+// and still gives the same noise. One block of four 32 bit words serves four consecutive indices.
+//------------------------------------------------------------------------------------------------------------------------------
+struct PhiloxKey
+{
+    uint32_t k0;
+    uint32_t k1;
+
+    PhiloxKey(uint32_t seed, uint32_t stream) : k0(seed), k1(stream) {}
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// the full 128 bit counter, as in the Random123 known answer tests
+inline void PhiloxRounds(const uint32_t Counter[4], PhiloxKey Key, uint32_t Out[4])
+{
+    uint32_t c0 = Counter[0];
+    uint32_t c1 = Counter[1];
+    uint32_t c2 = Counter[2];
+    uint32_t c3 = Counter[3];
+    uint32_t k0 = Key.k0;
+    uint32_t k1 = Key.k1;
+    for(int round = 0; round < 10; round++)
+    {
+        uint64_t product0 = (uint64_t)0xD2511F53u * c0;
+        uint64_t product1 = (uint64_t)0xCD9E8D57u * c2;
+        uint32_t n0 = (uint32_t)(product1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t)(product0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)product1;
+        c3 = (uint32_t)product0;
+        c0 = n0;
+        c2 = n2;
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    Out[0] = c0;
+    Out[1] = c1;
+    Out[2] = c2;
+    Out[3] = c3;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// block blockNr of a stream, the upper half of the counter stays 0
+inline void PhiloxBlock(PhiloxKey Key, uint64_t blockNr, uint32_t Out[4])
+{
+    uint32_t Counter[4] = {(uint32_t)blockNr, (uint32_t)(blockNr >> 32), 0, 0};
+    PhiloxRounds(Counter, Key, Out);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// uniform in (0, 1], never 0 so that the logarithm below is finite
+inline double PhiloxToUnit(uint32_t value)
+{
+    return ((double)value + 1.0) * (1.0 / 4294967296.0);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// standard normal values for indices first .. first + count - 1, Box-Muller on the two word pairs of each block
+inline void PhiloxNormals(PhiloxKey Key, uint64_t first, int count, double *Out)
+{
+    const double twoPi = 6.283185307179586;
+    uint64_t index = first;
+    uint64_t last = first + (uint64_t)count;
+    while(index < last)
+    {
+        uint32_t Block[4];
+        PhiloxBlock(Key, index >> 2, Block);
+        double Normals[4];
+        for(int pair = 0; pair < 4; pair += 2)
+        {
+            double radius = sqrt(-2.0 * log(PhiloxToUnit(Block[pair])));
+            double angle = twoPi * PhiloxToUnit(Block[pair + 1]);
+            Normals[pair] = radius * cos(angle);
+            Normals[pair + 1] = radius * sin(angle);
+        }
+        for(int lane = (int)(index & 3); lane < 4 && index < last; lane++, index++)
+            *Out++ = Normals[lane];
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// integers uniform in [minValue, maxValue] for indices first .. first + count - 1
+inline void PhiloxUniformInts(PhiloxKey Key, uint64_t first, int count, int32_t minValue, int32_t maxValue, int32_t *Out)
+{
+    uint64_t range = (uint64_t)((int64_t)maxValue - (int64_t)minValue + 1);
+    uint64_t index = first;
+    uint64_t last = first + (uint64_t)count;
+    while(index < last)
+    {
+        uint32_t Block[4];
+        PhiloxBlock(Key, index >> 2, Block);
+        for(int lane = (int)(index & 3); lane < 4 && index < last; lane++, index++)
+            *Out++ = (int32_t)((int64_t)minValue + (int64_t)(((uint64_t)Block[lane] * range) >> 32));
+    }
+}
+
+#endif // PHILOXRNG_H
@@ -0,0 +1,211 @@
+#include "roigrid.h"
+
+#include <algorithm>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+using namespace std;
+using namespace cv;
+
+namespace
+{
+//------------------------------------------------------------------------------------------------------------------------------
+int FloorDiv(int64_t a, int64_t b)
+{
+    return (int)(a >= 0 ? a / b : -((-a + b - 1) / b));
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// number of grid positions offset + i * shift below last
+int PositionsCount(int offset, int shift, int last)
+{
+    if(shift <= 0 || offset >= last)
+        return 0;
+    return FloorDiv((int64_t)last - offset - 1, shift) + 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// positions begin .. end - 1 whose low .. high extent around offset + i * shift meets first .. last
+void PositionRange(int offset, int shift, int count, int low, int high, int first, int last, int &begin, int &end)
+{
+    begin = max(0, -FloorDiv(-((int64_t)first - high - offset), shift));
+    end = min(count, FloorDiv((int64_t)last - low - offset, shift) + 1);
+}
+}
+//------------------------------------------------------------------------------------------------------------------------------
+RoiGrid::RoiGrid() :
+    offset(0),
+    shift(0),
+    reduced(0),
+    complement(0),
+    period(1),
+    columns(0),
+    rows(0)
+{
+}
+//------------------------------------------------------------------------------------------------------------------------------
+RoiGrid::RoiGrid(Size ImageSize, int roiShape, int roiSize, int roiOffset, int roiShift,
+                 bool reducedRoi, bool reducedRoiComplement, int skipCount) :
+    ImSize(ImageSize),
+    offset(roiOffset),
+    shift(roiShift),
+    reduced(reducedRoi),
+    complement(reducedRoiComplement),
+    period(max(skipCount, 0) + 1)
+{
+    columns = PositionsCount(offset, shift, ImSize.width - roiSize / 2);
+    rows = PositionsCount(offset, shift, ImSize.height - roiSize / 2);
+
+    switch(roiShape)
+    {
+    case 1:
+    {
+        // the pixels cv::circle fills, the same for every centre
+        int radius = roiSize / 2;
+        Mat Template = Mat::zeros(2 * radius + 1, 2 * radius + 1, CV_16U);
+        circle(Template, Point(radius, radius), radius, 1, -1);
+        RoiIndex TemplateIndex;
+        TemplateIndex.Build(Template);
+        TemplateIndex.ForEachSpan(1, [&](const RoiSpan &Span)
+        {
+            RoiSpan Centred = Span;
+            Centred.y -= radius;
+            Centred.xStart -= radius;
+            Centred.xEnd -= radius;
+            ShapeSpans.push_back(Centred);
+        });
+        break;
+    }
+    default:
+        int roiLeftTopBorderOffset = roiSize / 2 ;
+        int roiRigthBottomBorderOffset =  roiSize - roiSize / 2 - 1 ;
+        for(int y = -roiLeftTopBorderOffset; y <= roiRigthBottomBorderOffset; y++)
+        {
+            RoiSpan Span;
+            Span.y = y;
+            Span.xStart = -roiLeftTopBorderOffset;
+            Span.xEnd = roiRigthBottomBorderOffset + 1;
+            ShapeSpans.push_back(Span);
+        }
+        break;
+    }
+
+    if(ShapeSpans.empty())
+    {
+        columns = 0;
+        rows = 0;
+        return;
+    }
+    int minX = ShapeSpans[0].xStart;
+    int maxX = ShapeSpans[0].xEnd - 1;
+    for(const RoiSpan &Span : ShapeSpans)
+    {
+        minX = min(minX, Span.xStart);
+        maxX = max(maxX, Span.xEnd - 1);
+    }
+    ShapeBox = Rect(minX, ShapeSpans.front().y, maxX - minX + 1, ShapeSpans.back().y - ShapeSpans.front().y + 1);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Size RoiGrid::MaskSize() const
+{
+    return ImSize;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+int RoiGrid::MaxRoiNr() const
+{
+    int positions = columns * rows;
+    if(!reduced)
+        return positions;
+    int kept = (positions + period - 1) / period;
+    return complement ? positions - kept : kept;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// 0 for a position the reduced grid skips
+int RoiGrid::RoiNrAt(int position) const
+{
+    if(!reduced)
+        return position + 1;
+    bool first = position % period == 0;
+    if(!complement)
+        return first ? position / period + 1 : 0;
+    return first ? 0 : position - position / period;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+int RoiGrid::PositionOf(int roiNr) const
+{
+    if(!reduced)
+        return roiNr - 1;
+    if(!complement)
+        return (roiNr - 1) * period;
+    return (roiNr - 1) / (period - 1) * period + (roiNr - 1) % (period - 1) + 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Rect RoiGrid::BoundingBox(int roiNr) const
+{
+    if(roiNr < 1 || roiNr > MaxRoiNr())
+        return Rect();
+    int position = PositionOf(roiNr);
+    Point Centre(offset + position % columns * shift, offset + position / columns * shift);
+    return (ShapeBox + Centre) & Rect(Point(0, 0), ImSize);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool RoiGrid::Contains(int roiNr) const
+{
+    Rect Box = BoundingBox(roiNr);
+    if(Box.area() <= 0)
+        return 0;
+    RoiIndex Index;
+    vector<int> RoiNrs;
+    TileIndex(Box, Index, RoiNrs);
+    vector<int>::const_iterator Found = lower_bound(RoiNrs.begin(), RoiNrs.end(), roiNr);
+    return Found != RoiNrs.end() && *Found == roiNr && Index.Contains((int)(Found - RoiNrs.begin()) + 1);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// ROIs whose shape box meets Area, in ROI number order
+template<class Visit>
+void RoiGrid::VisitRois(Rect Area, Visit visit) const
+{
+    int firstRow, endRow, firstColumn, endColumn;
+    PositionRange(offset, shift, rows, ShapeBox.y, ShapeBox.y + ShapeBox.height - 1,
+                  Area.y, Area.y + Area.height - 1, firstRow, endRow);
+    PositionRange(offset, shift, columns, ShapeBox.x, ShapeBox.x + ShapeBox.width - 1,
+                  Area.x, Area.x + Area.width - 1, firstColumn, endColumn);
+    for(int row = firstRow; row < endRow; row++)
+    {
+        for(int column = firstColumn; column < endColumn; column++)
+        {
+            int roiNr = RoiNrAt(row * columns + column);
+            if(roiNr)
+                visit(roiNr, Point(offset + column * shift, offset + row * shift));
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void RoiGrid::AddShape(RoiIndex &Index, int label, Point Centre, Point Origin) const
+{
+    for(const RoiSpan &Span : ShapeSpans)
+        Index.AddSpan(label, Centre.y + Span.y - Origin.y, Centre.x + Span.xStart - Origin.x, Centre.x + Span.xEnd - Origin.x);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+RoiIndex RoiGrid::FullIndex() const
+{
+    RoiIndex Index;
+    Index.Reset(ImSize);
+    VisitRois(Rect(Point(0, 0), ImSize), [&](int roiNr, Point Centre)
+    {
+        AddShape(Index, roiNr, Centre, Point(0, 0));
+    });
+    Index.Finish();
+    return Index;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void RoiGrid::TileIndex(Rect Area, RoiIndex &Index, vector<int> &RoiNrs) const
+{
+    Area &= Rect(Point(0, 0), ImSize);
+    Index.Reset(Area.size());
+    RoiNrs.clear();
+    VisitRois(Area, [&](int roiNr, Point Centre)
+    {
+        RoiNrs.push_back(roiNr);
+        AddShape(Index, (int)RoiNrs.size(), Centre, Area.tl());
+    });
+    Index.Finish();
+}
@@ -0,0 +1,56 @@
+#ifndef ROIGRID_H
+#define ROIGRID_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "roiindex.h"
+
+//------------------------------------------------------------------------------------------------------------------------------
+// The CreateROI grid defined by its parameters only. ROI numbers, boxes and pixels are computed on
+// demand, so an area of the image is rasterised without touching the rest and memory follows the
+// size of that area. Numbering and overlaps are those of painting the grid row by row: ROIs are
+// numbered in grid order, reducedRoi keeps one position of every skipCount + 1, the complement keeps
+// the others, and where ROIs overlap the later one wins.
+//------------------------------------------------------------------------------------------------------------------------------
+class RoiGrid
+{
+public:
+    RoiGrid();
+    RoiGrid(cv::Size ImageSize, int roiShape, int roiSize, int roiOffset, int roiShift,
+            bool reducedRoi, bool reducedRoiComplement, int skipCount);
+
+    cv::Size MaskSize() const;
+    int MaxRoiNr() const;
+    // 0 also for a ROI that later ROIs cover entirely
+    bool Contains(int roiNr) const;
+    // box of the shape clipped to the image, the ROI can be smaller where later ROIs overlap it
+    cv::Rect BoundingBox(int roiNr) const;
+
+    // every ROI of the image, labelled with its ROI number
+    RoiIndex FullIndex() const;
+    // ROIs touching Area, in Area coordinates; labels are 1 .. RoiNrs.size() in ROI number order
+    // and label l is ROI RoiNrs[l - 1]
+    void TileIndex(cv::Rect Area, RoiIndex &Index, std::vector<int> &RoiNrs) const;
+
+private:
+    template<class Visit>
+    void VisitRois(cv::Rect Area, Visit visit) const;
+    void AddShape(RoiIndex &Index, int label, cv::Point Centre, cv::Point Origin) const;
+    int RoiNrAt(int position) const;
+    int PositionOf(int roiNr) const;
+
+    cv::Size ImSize;
+    int offset;
+    int shift;
+    bool reduced;
+    bool complement;
+    int period;                         // reducedRoi keeps the first position of every period
+    int columns;
+    int rows;
+    std::vector<RoiSpan> ShapeSpans;    // pixels of the ROI centred at 0, 0
+    cv::Rect ShapeBox;
+};
+
+#endif // ROIGRID_H
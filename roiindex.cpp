@@ -0,0 +1,402 @@
+#include "roiindex.h"
+
+#include <algorithm>
+#include <queue>
+
+using namespace std;
+using namespace cv;
+
+namespace
+{
+//------------------------------------------------------------------------------------------------------------------------------
+// rows firstRow .. lastRow - 1 of stripe nr stripe out of stripesCount
+int StripeRow(int rows, int stripe, int stripesCount)
+{
+    return (int)((int64_t)rows * stripe / stripesCount);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void AppendSpan(vector<LabelledRoiSpan> &Out, int roiNr, int y, int xStart, int xEnd)
+{
+    if(!Out.empty() && Out.back().roiNr == roiNr && Out.back().Span.y == y && Out.back().Span.xEnd == xStart)
+    {
+        Out.back().Span.xEnd = xEnd;
+        return;
+    }
+    LabelledRoiSpan Run;
+    Run.roiNr = roiNr;
+    Run.Span.y = y;
+    Run.Span.xStart = xStart;
+    Run.Span.xEnd = xEnd;
+    Out.push_back(Run);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// spans of one row made disjoint, the larger roiNr wins where spans overlap; Out gets maximal runs in column order
+void ResolveRow(vector<LabelledRoiSpan> &Row, vector<LabelledRoiSpan> &Out)
+{
+    sort(Row.begin(), Row.end(), [](const LabelledRoiSpan &A, const LabelledRoiSpan &B)
+    {
+        return A.Span.xStart < B.Span.xStart;
+    });
+    // active spans by roiNr, a span that has ended is dropped when it comes to the top
+    priority_queue<pair<int, int>> Active;
+    size_t next = 0;
+    int x = 0;
+    while(next < Row.size() || !Active.empty())
+    {
+        if(Active.empty())
+            x = max(x, Row[next].Span.xStart);
+        while(next < Row.size() && Row[next].Span.xStart <= x)
+        {
+            Active.push(make_pair(Row[next].roiNr, Row[next].Span.xEnd));
+            next++;
+        }
+        while(!Active.empty() && Active.top().second <= x)
+            Active.pop();
+        if(Active.empty())
+            continue;
+        int xEnd = Active.top().second;
+        if(next < Row.size())
+            xEnd = min(xEnd, Row[next].Span.xStart);
+        AppendSpan(Out, Active.top().first, Row[0].Span.y, x, xEnd);
+        x = xEnd;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// runs of A that are also in B, both in column order and disjoint
+void IntersectRuns(const vector<RoiSpan> &A, const RoiSpan *B, int bCount, vector<RoiSpan> &Out)
+{
+    Out.clear();
+    size_t i = 0;
+    int j = 0;
+    while(i < A.size() && j < bCount)
+    {
+        RoiSpan Common = A[i];
+        Common.xStart = max(A[i].xStart, B[j].xStart);
+        Common.xEnd = min(A[i].xEnd, B[j].xEnd);
+        if(Common.xStart < Common.xEnd)
+            Out.push_back(Common);
+        if(A[i].xEnd < B[j].xEnd)
+            i++;
+        else
+            j++;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// runs of rows firstRow .. lastRow - 1 of a label mask
+template<class T>
+void MaskRuns(const Mat &Mask, int firstRow, int lastRow, vector<LabelledRoiSpan> &Runs)
+{
+    for(int y = firstRow; y < lastRow; y++)
+    {
+        const T *wMask = Mask.ptr<T>(y);
+        int x = 0;
+        while(x < Mask.cols)
+        {
+            T roiNr = wMask[x];
+            int xStart = x;
+            while(x < Mask.cols && wMask[x] == roiNr)
+                x++;
+            if(roiNr > 0)
+                AppendSpan(Runs, (int)roiNr, y, xStart, x);
+        }
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// ROIs are disjoint, so they are painted in parallel
+template<class T>
+void PaintLabels(const RoiIndex &Index, Mat &Mask, bool wrap)
+{
+    parallel_for_(Range(1, Index.MaxRoiNr() + 1), [&](const Range &Rois)
+    {
+        for(int roiNr = Rois.start; roiNr < Rois.end; roiNr++)
+        {
+            T label = (T)(wrap ? (roiNr - 1) % 65535 + 1 : roiNr);
+            Index.ForEachSpan(roiNr, [&](const RoiSpan &Span)
+            {
+                T *wMask = Mask.ptr<T>(Span.y);
+                for(int x = Span.xStart; x < Span.xEnd; x++)
+                    wMask[x] = label;
+            });
+        }
+    });
+}
+}
+//------------------------------------------------------------------------------------------------------------------------------
+RoiIndex::RoiIndex()
+{
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool RoiIndex::Build(Mat Mask)
+{
+    Reset(Mask.size());
+    if(Mask.empty() || (Mask.type() != CV_16U && Mask.type() != CV_32S))
+    {
+        Assign(vector<vector<LabelledRoiSpan>>());
+        return 0;
+    }
+
+    // runs of each row stripe, the stripes are concatenated in row order
+    int stripesCount = min(max(getNumThreads(), 1), Mask.rows);
+    vector<vector<LabelledRoiSpan>> Stripes(stripesCount);
+    parallel_for_(Range(0, stripesCount), [&](const Range &StripeRange)
+    {
+        for(int stripe = StripeRange.start; stripe < StripeRange.end; stripe++)
+        {
+            int firstRow = StripeRow(Mask.rows, stripe, stripesCount);
+            int lastRow = StripeRow(Mask.rows, stripe + 1, stripesCount);
+            if(Mask.type() == CV_16U)
+                MaskRuns<uint16_t>(Mask, firstRow, lastRow, Stripes[stripe]);
+            else
+                MaskRuns<int32_t>(Mask, firstRow, lastRow, Stripes[stripe]);
+        }
+    });
+    Assign(Stripes);
+    return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void RoiIndex::Reset(Size MaskSize)
+{
+    ImSize = MaskSize;
+    Pending.clear();
+    FirstSpan.clear();
+    AllSpans.clear();
+    Boxes.clear();
+    Areas.clear();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void RoiIndex::AddSpan(int roiNr, int y, int xStart, int xEnd)
+{
+    xStart = max(xStart, 0);
+    xEnd = min(xEnd, ImSize.width);
+    if(roiNr <= 0 || y < 0 || y >= ImSize.height || xStart >= xEnd)
+        return;
+    LabelledRoiSpan Run;
+    Run.roiNr = roiNr;
+    Run.Span.y = y;
+    Run.Span.xStart = xStart;
+    Run.Span.xEnd = xEnd;
+    Pending.push_back(Run);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void RoiIndex::Finish()
+{
+    // pending spans by row, then every row made disjoint by row stripes
+    vector<uint32_t> FirstInRow(ImSize.height + 1, 0);
+    for(const LabelledRoiSpan &Run : Pending)
+        FirstInRow[Run.Span.y + 1]++;
+    for(int y = 1; y <= ImSize.height; y++)
+        FirstInRow[y] += FirstInRow[y - 1];
+    vector<LabelledRoiSpan> ByRow(Pending.size());
+    vector<uint32_t> NextInRow(FirstInRow.begin(), FirstInRow.end() - 1);
+    for(const LabelledRoiSpan &Run : Pending)
+        ByRow[NextInRow[Run.Span.y]++] = Run;
+    vector<LabelledRoiSpan>().swap(Pending);
+
+    int stripesCount = min(max(getNumThreads(), 1), max(ImSize.height, 1));
+    vector<vector<LabelledRoiSpan>> Stripes(stripesCount);
+    parallel_for_(Range(0, stripesCount), [&](const Range &StripeRange)
+    {
+        vector<LabelledRoiSpan> Row;
+        for(int stripe = StripeRange.start; stripe < StripeRange.end; stripe++)
+        {
+            for(int y = StripeRow(ImSize.height, stripe, stripesCount); y < StripeRow(ImSize.height, stripe + 1, stripesCount); y++)
+            {
+                if(FirstInRow[y] == FirstInRow[y + 1])
+                    continue;
+                Row.assign(ByRow.begin() + FirstInRow[y], ByRow.begin() + FirstInRow[y + 1]);
+                ResolveRow(Row, Stripes[stripe]);
+            }
+        }
+    });
+    Assign(Stripes);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// spans grouped by roiNr keeping their order in Parts, which is row order for Build and Finish
+void RoiIndex::Assign(const vector<vector<LabelledRoiSpan>> &Parts)
+{
+    int maxRoiNr = 0;
+    for(const vector<LabelledRoiSpan> &Runs : Parts)
+        for(const LabelledRoiSpan &Run : Runs)
+            maxRoiNr = max(maxRoiNr, Run.roiNr);
+
+    FirstSpan.assign(maxRoiNr + 2, 0);
+    Areas.assign(maxRoiNr + 1, 0);
+    vector<int> MinX(maxRoiNr + 1, INT32_MAX);
+    vector<int> MinY(maxRoiNr + 1, INT32_MAX);
+    vector<int> MaxX(maxRoiNr + 1, -1);
+    vector<int> MaxY(maxRoiNr + 1, -1);
+    for(const vector<LabelledRoiSpan> &Runs : Parts)
+    {
+        for(const LabelledRoiSpan &Run : Runs)
+        {
+            int roiNr = Run.roiNr;
+            FirstSpan[roiNr + 1]++;
+            Areas[roiNr] += Run.Span.xEnd - Run.Span.xStart;
+            MinX[roiNr] = min(MinX[roiNr], Run.Span.xStart);
+            MaxX[roiNr] = max(MaxX[roiNr], Run.Span.xEnd - 1);
+            MinY[roiNr] = min(MinY[roiNr], Run.Span.y);
+            MaxY[roiNr] = max(MaxY[roiNr], Run.Span.y);
+        }
+    }
+    for(int roiNr = 1; roiNr <= maxRoiNr + 1; roiNr++)
+        FirstSpan[roiNr] += FirstSpan[roiNr - 1];
+
+    AllSpans.resize(FirstSpan[maxRoiNr + 1]);
+    vector<uint32_t> NextSpan(FirstSpan.begin(), FirstSpan.end() - 1);
+    for(const vector<LabelledRoiSpan> &Runs : Parts)
+        for(const LabelledRoiSpan &Run : Runs)
+            AllSpans[NextSpan[Run.roiNr]++] = Run.Span;
+
+    Boxes.assign(maxRoiNr + 1, Rect());
+    for(int roiNr = 1; roiNr <= maxRoiNr; roiNr++)
+    {
+        if(Areas[roiNr])
+            Boxes[roiNr] = Rect(MinX[roiNr], MinY[roiNr], MaxX[roiNr] - MinX[roiNr] + 1, MaxY[roiNr] - MinY[roiNr] + 1);
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Size RoiIndex::MaskSize() const
+{
+    return ImSize;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+int RoiIndex::MaxRoiNr() const
+{
+    return Areas.empty() ? 0 : (int)Areas.size() - 1;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+bool RoiIndex::Contains(int roiNr) const
+{
+    return roiNr > 0 && roiNr < (int)Areas.size() && Areas[roiNr];
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Rect RoiIndex::BoundingBox(int roiNr) const
+{
+    if(!Contains(roiNr))
+        return Rect();
+    return Boxes[roiNr];
+}
+//------------------------------------------------------------------------------------------------------------------------------
+uint64_t RoiIndex::Area(int roiNr) const
+{
+    if(!Contains(roiNr))
+        return 0;
+    return Areas[roiNr];
+}
+//------------------------------------------------------------------------------------------------------------------------------
+int RoiIndex::SpanCount(int roiNr) const
+{
+    if(!Contains(roiNr))
+        return 0;
+    return (int)(FirstSpan[roiNr + 1] - FirstSpan[roiNr]);
+}
+//------------------------------------------------------------------------------------------------------------------------------
+const RoiSpan *RoiIndex::Spans(int roiNr) const
+{
+    if(!Contains(roiNr))
+        return 0;
+    return AllSpans.data() + FirstSpan[roiNr];
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Mat RoiIndex::CropMask(int roiNr) const
+{
+    if(!Contains(roiNr))
+        return Mat();
+    Rect Box = Boxes[roiNr];
+    Mat SmallMask = Mat::zeros(Box.size(), CV_16U);
+    ForEachSpan(roiNr, [&](const RoiSpan &Span)
+    {
+        uint16_t *wSmallMask = SmallMask.ptr<uint16_t>(Span.y - Box.y);
+        for(int x = Span.xStart; x < Span.xEnd; x++)
+            wSmallMask[x - Box.x] = CropLabel;
+    });
+    return SmallMask;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Mat RoiIndex::ToMat() const
+{
+    if(MaxRoiNr() <= 65535)
+        return ToDisplayMat();
+    Mat Mask = Mat::zeros(ImSize, CV_32S);
+    PaintLabels<int32_t>(*this, Mask, 0);
+    return Mask;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+Mat RoiIndex::ToDisplayMat() const
+{
+    Mat Mask = Mat::zeros(ImSize, CV_16U);
+    PaintLabels<uint16_t>(*this, Mask, 1);
+    return Mask;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+// Row by row on the spans: the inside of a row is the row shrunk by one pixel on both sides and
+// intersected with the rows above and below, the contour is the row minus its inside.
+RoiIndex RoiIndex::Contour() const
+{
+    int maxRoiNr = MaxRoiNr();
+    int partsCount = min(max(getNumThreads(), 1), max(maxRoiNr, 1));
+    vector<vector<LabelledRoiSpan>> Parts(partsCount);
+    parallel_for_(Range(0, partsCount), [&](const Range &PartRange)
+    {
+        vector<RoiSpan> Inside, Common;
+        for(int part = PartRange.start; part < PartRange.end; part++)
+        {
+            for(int roiNr = StripeRow(maxRoiNr, part, partsCount) + 1; roiNr <= StripeRow(maxRoiNr, part + 1, partsCount); roiNr++)
+            {
+                const RoiSpan *RoiSpans = Spans(roiNr);
+                int count = SpanCount(roiNr);
+                int previousRow = 0, previousCount = 0;
+                int row = 0;
+                while(row < count)
+                {
+                    int y = RoiSpans[row].y;
+                    int rowCount = 0;
+                    while(row + rowCount < count && RoiSpans[row + rowCount].y == y)
+                        rowCount++;
+                    int nextRow = row + rowCount;
+                    int nextCount = 0;
+                    while(nextRow + nextCount < count && RoiSpans[nextRow + nextCount].y == y + 1)
+                        nextCount++;
+                    if(previousCount && RoiSpans[previousRow].y != y - 1)
+                        previousCount = 0;
+
+                    Inside.clear();
+                    for(int i = row; i < nextRow; i++)
+                    {
+                        if(RoiSpans[i].xEnd - RoiSpans[i].xStart > 2)
+                        {
+                            RoiSpan Shrunk = RoiSpans[i];
+                            Shrunk.xStart++;
+                            Shrunk.xEnd--;
+                            Inside.push_back(Shrunk);
+                        }
+                    }
+                    IntersectRuns(Inside, RoiSpans + previousRow, previousCount, Common);
+                    IntersectRuns(Common, RoiSpans + nextRow, nextCount, Inside);
+
+                    size_t inside = 0;
+                    for(int i = row; i < nextRow; i++)
+                    {
+                        int x = RoiSpans[i].xStart;
+                        while(inside < Inside.size() && Inside[inside].xEnd <= RoiSpans[i].xEnd)
+                        {
+                            if(Inside[inside].xStart > x)
+                                AppendSpan(Parts[part], roiNr, y, x, Inside[inside].xStart);
+                            x = Inside[inside].xEnd;
+                            inside++;
+                        }
+                        if(x < RoiSpans[i].xEnd)
+                            AppendSpan(Parts[part], roiNr, y, x, RoiSpans[i].xEnd);
+                    }
+                    previousRow = row;
+                    previousCount = rowCount;
+                    row = nextRow;
+                }
+            }
+        }
+    });
+    RoiIndex Out;
+    Out.Reset(ImSize);
+    Out.Assign(Parts);
+    return Out;
+}
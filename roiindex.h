@@ -0,0 +1,83 @@
+#ifndef ROIINDEX_H
+#define ROIINDEX_H
+
+#include <vector>
+#include <cstdint>
+
+#include <opencv2/core/core.hpp>
+
+//------------------------------------------------------------------------------------------------------------------------------
+// Horizontal run of one ROI, pixels xStart .. xEnd - 1 of row y
+//------------------------------------------------------------------------------------------------------------------------------
+struct RoiSpan
+{
+    int y;
+    int xStart;
+    int xEnd;
+};
+//------------------------------------------------------------------------------------------------------------------------------
+struct LabelledRoiSpan
+{
+    int roiNr;
+    RoiSpan Span;
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// Run length label mask: bounding box, area and spans of every ROI of an image, nothing is stored
+// for the background. Memory and per ROI work scale with the ROI area, not with the image size.
+// Spans of a ROI are stored together, ordered by row and column, ROIs never share a pixel.
+// Made from a dense 16U or 32S mask with Build, or from shapes with Reset, AddSpan and Finish.
+// Labels are 32 bit; cost per label is a few words, so grids of millions of ROIs are fine.
+//------------------------------------------------------------------------------------------------------------------------------
+class RoiIndex
+{
+public:
+    // value of the ROI pixels in CropMask, for the functions taking a 16U mask and a 16 bit ROI number
+    static const int CropLabel = 1;
+
+    RoiIndex();
+
+    bool Build(cv::Mat Mask);
+
+    // spans may overlap, on a shared pixel the larger roiNr wins as if painted in label order
+    void Reset(cv::Size MaskSize);
+    void AddSpan(int roiNr, int y, int xStart, int xEnd);
+    void Finish();
+
+    cv::Size MaskSize() const;
+    int MaxRoiNr() const;
+    bool Contains(int roiNr) const;
+    cv::Rect BoundingBox(int roiNr) const;
+    uint64_t Area(int roiNr) const;
+    int SpanCount(int roiNr) const;
+    const RoiSpan *Spans(int roiNr) const;
+
+    template<class Visit>
+    void ForEachSpan(int roiNr, Visit visit) const
+    {
+        const RoiSpan *Span = Spans(roiNr);
+        const RoiSpan *SpanEnd = Span + SpanCount(roiNr);
+        for(; Span != SpanEnd; Span++)
+            visit(*Span);
+    }
+
+    // 16U mask of the bounding box, CropLabel on the pixels of the ROI and 0 elsewhere
+    cv::Mat CropMask(int roiNr) const;
+    // full size label mask, 16U while the labels fit and 32S past 65535
+    cv::Mat ToMat() const;
+    // full size 16U mask for ShowRegion and the other display functions, labels past 65535 wrap to 1
+    cv::Mat ToDisplayMat() const;
+    // pixels of every ROI with a 4 neighbour outside it, as GetContour5 gives for a dense mask
+    RoiIndex Contour() const;
+
+private:
+    void Assign(const std::vector<std::vector<LabelledRoiSpan>> &Parts);
+
+    cv::Size ImSize;
+    std::vector<LabelledRoiSpan> Pending;   // spans added since Reset
+    std::vector<uint32_t> FirstSpan;        // spans of roiNr are AllSpans[FirstSpan[roiNr] .. FirstSpan[roiNr + 1] - 1]
+    std::vector<RoiSpan> AllSpans;
+    std::vector<cv::Rect> Boxes;
+    std::vector<uint64_t> Areas;
+};
+
+#endif // ROIINDEX_H
@@ -0,0 +1,111 @@
+#ifndef STAGEMEMO_H
+#define STAGEMEMO_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <opencv2/core/core.hpp>
+
+#include "roiindex.h"
+#include "roigrid.h"
+
+//------------------------------------------------------------------------------------------------------------------------------
+// Last result of one processing stage. The key holds every parameter the stage depends on together
+// with the key of the stage feeding it, so a change upstream invalidates everything downstream.
+// Stored images are shared with the caller and must not be modified in place.
+//------------------------------------------------------------------------------------------------------------------------------
+template<class T>
+class MemoStage
+{
+public:
+    MemoStage() : valid(0) {}
+
+    bool Get(const std::string &NewKey, T &Out) const
+    {
+        if(!valid || Key != NewKey)
+            return 0;
+        Out = Value;
+        return 1;
+    }
+    void Put(const std::string &NewKey, const T &NewValue)
+    {
+        Key = NewKey;
+        Value = NewValue;
+        valid = 1;
+    }
+    void Clear()
+    {
+        Key.clear();
+        Value = T();
+        valid = 0;
+    }
+
+private:
+    std::string Key;
+    T Value;
+    bool valid;
+};
+//------------------------------------------------------------------------------------------------------------------------------
+struct NoiseStageOut
+{
+    cv::Mat Im;                         // 32S, input with all enabled noises applied
+    std::vector<cv::Mat> NoiseIms;      // each added noise, for the noise histograms
+};
+//------------------------------------------------------------------------------------------------------------------------------
+struct RoiMaskStageOut
+{
+    int maxRoiNr;
+    std::shared_ptr<const RoiGrid> Grid;    // CreateROI grid, empty for masks loaded from a file
+    std::shared_ptr<const RoiIndex> Index;  // run length mask, ROIs numbered from 1; CreateROI makes it only when needed
+
+    RoiMaskStageOut() : maxRoiNr(0) {}
+};
+//------------------------------------------------------------------------------------------------------------------------------
+struct RoiCropStageOut
+{
+    cv::Mat SmallIm;
+    cv::Mat SmallMask;
+};
+//------------------------------------------------------------------------------------------------------------------------------
+// Memoized stages of the interactive modes. Owned by the caller that re-runs one image with
+// changing parameters (the GUI background processor); batch runs pass none and compute everything.
+// Not thread safe, one instance per worker.
+//------------------------------------------------------------------------------------------------------------------------------
+struct StageMemo
+{
+    // ImageLinearOperation: scale -> noise -> gradient -> offset and convert
+    MemoStage<cv::Mat> LinearScaled;
+    MemoStage<NoiseStageOut> LinearNoise;
+    MemoStage<cv::Mat> LinearGradient;
+    MemoStage<cv::Mat> LinearOut;
+
+    // CreateROI: mask -> ROI crop -> binning
+    MemoStage<RoiMaskStageOut> RoiMask;
+    MemoStage<RoiCropStageOut> RoiCrop;
+    MemoStage<cv::Mat> RoiBinned;
+
+    // ViewRoi: mask loaded from the .roi file
+    MemoStage<RoiMaskStageOut> ViewRoiMask;
+
+    StageMemo() : inputGeneration(0) {}
+
+    // key of the input image, a new decode or a new file starts a new generation
+    std::string InputKey(const std::string &FileName, const cv::Mat &Im)
+    {
+        if(Im.data != Input.data || FileName != InputFileName)
+        {
+            Input = Im;
+            InputFileName = FileName;
+            inputGeneration++;
+        }
+        return std::to_string(inputGeneration);
+    }
+
+private:
+    cv::Mat Input;                      // held so the buffer address cannot be reused by another image
+    std::string InputFileName;
+    unsigned long inputGeneration;
+};
+
+#endif // STAGEMEMO_H
@@ -0,0 +1,59 @@
+#ifndef STAGETIMER_H
+#define STAGETIMER_H
+
+#include <string>
+#include <map>
+#include <chrono>
+
+//------------------------------------------------------------------------------------------------------------------------------
+// Accumulated wall time of one processing stage. In a batch the stages of different files overlap,
+// so the sum over stages can exceed the run time.
+//------------------------------------------------------------------------------------------------------------------------------
+struct StageTime
+{
+    double seconds;
+    long long calls;
+
+    StageTime() : seconds(0.0), calls(0) {}
+};
+
+typedef std::map<std::string, StageTime> StageTimes;
+
+//------------------------------------------------------------------------------------------------------------------------------
+// adds the time from construction to destruction to Times[Name]
+class ScopedTimer
+{
+public:
+    ScopedTimer(StageTimes &Times, const char *Name) :
+        Times(Times),
+        Name(Name),
+        Start(std::chrono::steady_clock::now())
+    {
+    }
+    ~ScopedTimer()
+    {
+        std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - Start;
+        StageTime &Time = Times[Name];
+        Time.seconds += Elapsed.count();
+        Time.calls++;
+    }
+
+private:
+    ScopedTimer(const ScopedTimer &);
+    ScopedTimer &operator=(const ScopedTimer &);
+
+    StageTimes &Times;
+    const char *Name;
+    std::chrono::steady_clock::time_point Start;
+};
+//------------------------------------------------------------------------------------------------------------------------------
+inline void AddStageTimes(StageTimes &Total, const StageTimes &Part)
+{
+    for(auto &Item : Part)
+    {
+        Total[Item.first].seconds += Item.second.seconds;
+        Total[Item.first].calls += Item.second.calls;
+    }
+}
+
+#endif // STAGETIMER_H